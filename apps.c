@@ -0,0 +1,375 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "apps.h"
+#include "varint.h"
+#include "files.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// File: magic, entry count, then per entry active seconds, keys, clicks,
+// pixels as two words, last use, name length and the name
+
+static const char appsMagic[4] = { 'A', 'M', 'P', '1' };
+
+#define APPS_MASK (APPS_CAPACITY - 1)
+#define APPS_ENTRY_SIZE (6 * 4 + 1)
+
+AppTable appTable;
+
+static size_t Clicks(const Counter* c)
+{
+    return c->left + c->middle + c->right + c->fourth + c->fifth;
+}
+
+// FNV-1a, never 0 as that marks a free slot
+static uint32 Hash(const char* name)
+{
+    uint32 hash = 2166136261UL;
+
+    while (*name) {
+        hash ^= (uint8)*name++;
+        hash *= 16777619UL;
+    }
+
+    return hash ? hash : 1;
+}
+
+static size_t Probe(const AppTable* at, const char* const name, uint32 hash)
+{
+    size_t i = hash & APPS_MASK;
+
+    while (at->slots[i].hash && (at->slots[i].hash != hash || strcmp(at->slots[i].name, name) != 0)) {
+        i = (i + 1) & APPS_MASK;
+    }
+
+    return i;
+}
+
+// Backward shift deletion, so that linear probing needs no tombstones
+static void RemoveSlot(AppTable* at, size_t hole)
+{
+    size_t i = hole;
+
+    for (;;) {
+        i = (i + 1) & APPS_MASK;
+
+        if (!at->slots[i].hash) {
+            break;
+        }
+
+        const size_t home = at->slots[i].hash & APPS_MASK;
+
+        // Entries whose home is cyclically between the hole and their slot stay
+        const BOOL stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+
+        if (!stays) {
+            at->slots[hole] = at->slots[i];
+            hole = i;
+        }
+    }
+
+    memset(&at->slots[hole], 0, sizeof(AppEntry));
+    at->count--;
+}
+
+static void EvictLeastRecent(AppTable* at)
+{
+    size_t oldest = APPS_CAPACITY;
+
+    for (size_t i = 0; i < APPS_CAPACITY; i++) {
+        if (at->slots[i].hash && (oldest == APPS_CAPACITY || at->slots[i].lastUsed < at->slots[oldest].lastUsed)) {
+            oldest = i;
+        }
+    }
+
+    if (oldest < APPS_CAPACITY) {
+        RemoveSlot(at, oldest);
+        at->evictions++;
+    }
+}
+
+static AppEntry* Insert(AppTable* at, const char* const name)
+{
+    const uint32 hash = Hash(name);
+    size_t i = Probe(at, name, hash);
+
+    if (!at->slots[i].hash) {
+        if (at->count >= APPS_MAX_ENTRIES) {
+            EvictLeastRecent(at);
+            i = Probe(at, name, hash);
+        }
+
+        AppEntry* e = &at->slots[i];
+
+        e->hash = hash;
+        snprintf(e->name, sizeof(e->name), "%s", name);
+        at->count++;
+    }
+
+    return &at->slots[i];
+}
+
+void AppsInit(AppTable* at, AppSampler sampler, const Counter* counter)
+{
+    memset(at, 0, sizeof(*at));
+
+    at->sampler = sampler;
+    at->lastKeys = counter->keys;
+    at->lastClicks = Clicks(counter);
+    at->lastPixels = counter->pixels;
+}
+
+AppEntry* AppsCharge(AppTable* at, const char* const name, uint32 activeSeconds, uint32 keys, uint32 clicks,
+    uint64 pixels)
+{
+    AppEntry* e = Insert(at, name);
+
+    e->lastUsed = ++at->clock;
+    e->activeSeconds += activeSeconds;
+    e->keys += keys;
+    e->clicks += clicks;
+    e->pixels += pixels;
+
+    return e;
+}
+
+const AppEntry* AppsFind(const AppTable* at, const char* const name)
+{
+    const size_t i = Probe(at, name, Hash(name));
+
+    return at->slots[i].hash ? &at->slots[i] : NULL;
+}
+
+void AppsOnTick(const StatsTick* tick, void* userData)
+{
+    AppTable* at = (AppTable *)userData;
+    const Counter* counter = tick->counter;
+
+    const size_t clicks = Clicks(counter);
+    const uint32 keys = counter->keys - at->lastKeys;
+    const uint32 newClicks = clicks - at->lastClicks;
+    const uint64 pixels = counter->pixels - at->lastPixels;
+
+    at->lastKeys = counter->keys;
+    at->lastClicks = clicks;
+    at->lastPixels = counter->pixels;
+
+    // Idle steps don't need to know the focus
+    if (!(tick->active || keys || newClicks || pixels)) {
+        return;
+    }
+
+    char name[APP_NAME_LENGTH];
+
+    if (at->sampler && at->sampler(name, sizeof(name))) {
+        AppsCharge(at, name, tick->active, keys, newClicks, pixels);
+    }
+}
+
+static BOOL MoreActive(const AppEntry* a, const AppEntry* b)
+{
+    if (a->activeSeconds != b->activeSeconds) {
+        return a->activeSeconds > b->activeSeconds;
+    }
+
+    return a->keys + a->clicks > b->keys + b->clicks;
+}
+
+size_t AppsTop(const AppTable* at, const AppEntry** entries, size_t max)
+{
+    size_t count = 0;
+
+    // Insertion into a short sorted list
+    for (size_t i = 0; i < APPS_CAPACITY; i++) {
+        const AppEntry* e = &at->slots[i];
+
+        if (!e->hash || (count == max && !MoreActive(e, entries[max - 1]))) {
+            continue;
+        }
+
+        size_t j = count < max ? count++ : max - 1;
+
+        while (j > 0 && MoreActive(e, entries[j - 1])) {
+            entries[j] = entries[j - 1];
+            j--;
+        }
+
+        entries[j] = e;
+    }
+
+    return count;
+}
+
+BOOL AppsLoad(AppTable* at, const char* const basePath)
+{
+    snprintf(at->path, sizeof(at->path), "%s.app", basePath);
+
+    FILE* file = fopen(at->path, "rb");
+
+    if (!file) {
+        return FALSE;
+    }
+
+    uint8 header[8];
+    BOOL ok = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+        memcmp(header, appsMagic, sizeof(appsMagic)) == 0;
+
+    const uint32 count = ok ? GetBE32(header + 4) : 0;
+
+    for (uint32 n = 0; ok && n < count; n++) {
+        uint8 fields[APPS_ENTRY_SIZE];
+        char name[APP_NAME_LENGTH];
+
+        ok = fread(fields, 1, sizeof(fields), file) == sizeof(fields) && fields[APPS_ENTRY_SIZE - 1] > 0 &&
+            fields[APPS_ENTRY_SIZE - 1] < APP_NAME_LENGTH;
+
+        if (ok) {
+            const size_t length = fields[APPS_ENTRY_SIZE - 1];
+
+            ok = fread(name, 1, length, file) == length;
+            name[length] = '\0';
+        }
+
+        if (ok) {
+            AppEntry* e = AppsCharge(at, name, GetBE32(fields), GetBE32(fields + 4), GetBE32(fields + 8),
+                ((uint64)GetBE32(fields + 12) << 32) | GetBE32(fields + 16));
+
+            e->lastUsed = GetBE32(fields + 20);
+
+            if (e->lastUsed > at->clock) {
+                at->clock = e->lastUsed;
+            }
+        }
+    }
+
+    fclose(file);
+
+    if (!ok) {
+        printf("Application file '%s' is damaged, %zu applications loaded\n", at->path, at->count);
+    }
+
+    return ok;
+}
+
+BOOL AppsSave(const AppTable* at)
+{
+    if (!at->path[0]) {
+        return FALSE;
+    }
+
+    char tempPath[APPS_PATH_LENGTH + 4];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", at->path);
+
+    FILE* file = fopen(tempPath, "wb");
+
+    if (!file) {
+        return FALSE;
+    }
+
+    uint8 header[8];
+    memcpy(header, appsMagic, sizeof(appsMagic));
+    PutBE32(header + 4, at->count);
+
+    BOOL ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    for (size_t i = 0; ok && i < APPS_CAPACITY; i++) {
+        const AppEntry* e = &at->slots[i];
+
+        if (!e->hash) {
+            continue;
+        }
+
+        uint8 fields[APPS_ENTRY_SIZE];
+        const size_t length = strlen(e->name);
+
+        PutBE32(fields, e->activeSeconds);
+        PutBE32(fields + 4, e->keys);
+        PutBE32(fields + 8, e->clicks);
+        PutBE32(fields + 12, (uint32)(e->pixels >> 32));
+        PutBE32(fields + 16, (uint32)e->pixels);
+        PutBE32(fields + 20, e->lastUsed);
+        fields[APPS_ENTRY_SIZE - 1] = (uint8)length;
+
+        ok = fwrite(fields, 1, sizeof(fields), file) == sizeof(fields) &&
+            fwrite(e->name, 1, length, file) == length;
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        remove(tempPath);
+        return FALSE;
+    }
+
+    return ReplaceFile(tempPath, at->path);
+}
+
+char* AppString(size_t rank)
+{
+    static FormatCache caches[APPS_SHOWN];
+    const AppEntry* top[APPS_SHOWN];
+
+    if (rank >= APPS_SHOWN) {
+        return "";
+    }
+
+    const size_t count = AppsTop(&appTable, top, APPS_SHOWN);
+    const AppEntry* e = rank < count ? top[rank] : NULL;
+
+    const uint64 keys[] = {
+        e ? e->hash : 0,
+        e ? e->activeSeconds / 60 : 0,
+        e ? e->keys : 0,
+        e ? e->clicks : 0
+    };
+
+    FormatCache* cache = &caches[rank];
+
+    if (FormatCacheStale(cache, keys, 4)) {
+        FormatBuilder b;
+
+        FormatBegin(&b, cache->text, sizeof(cache->text));
+        FormatNumber(&b, rank + 1);
+        FormatText(&b, FORMAT_LABEL(". "));
+
+        if (e) {
+            FormatText(&b, e->name, strlen(e->name));
+            FormatText(&b, FORMAT_LABEL(": "));
+            FormatNumber(&b, keys[1]);
+            FormatText(&b, FORMAT_LABEL(" min, "));
+            FormatNumber(&b, keys[2]);
+            FormatText(&b, FORMAT_LABEL(" keys, "));
+            FormatNumber(&b, keys[3]);
+            FormatText(&b, FORMAT_LABEL(" clicks"));
+        } else {
+            FormatText(&b, FORMAT_LABEL("-"));
+        }
+
+        FormatEnd(&b);
+    }
+
+    return cache->text;
+}
@@ -0,0 +1,87 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "common.h"
+
+// Activity per application. Each statistics tick asks a sampler which
+// application has the input focus and charges it with the activity since
+// the previous tick. The input handler isn't involved.
+//
+// Applications live in an open addressing table keyed by name. When it's
+// full the least recently charged application is evicted.
+
+#define APPS_CAPACITY 64 // Slots, a power of two
+#define APPS_MAX_ENTRIES 48 // Keeps the probe sequences short
+#define APPS_SHOWN 5
+#define APP_NAME_LENGTH 40
+#define APPS_PATH_LENGTH 256
+
+typedef struct AppEntry
+{
+    uint32 hash; // 0 for a free slot
+    uint32 lastUsed;
+    uint32 activeSeconds;
+    uint32 keys;
+    uint32 clicks;
+    uint64 pixels;
+    char name[APP_NAME_LENGTH];
+} AppEntry;
+
+// Copies the name of the focused application into the buffer. Returns
+// FALSE if nothing has the focus.
+typedef BOOL (*AppSampler)(char* name, size_t size);
+
+typedef struct AppTable
+{
+    AppSampler sampler;
+    uint32 clock; // Advances on every charge, for the LRU order
+    size_t count;
+    size_t evictions;
+    size_t lastKeys;
+    size_t lastClicks;
+    size_t lastPixels;
+    char path[APPS_PATH_LENGTH];
+    AppEntry slots[APPS_CAPACITY];
+} AppTable;
+
+extern AppTable appTable;
+
+void AppsInit(AppTable* at, AppSampler sampler, const Counter* counter);
+void AppsOnTick(const StatsTick* tick, void* userData);
+AppEntry* AppsCharge(AppTable* at, const char* const name, uint32 activeSeconds, uint32 keys, uint32 clicks,
+    uint64 pixels);
+const AppEntry* AppsFind(const AppTable* at, const char* const name);
+
+// Fills 'entries' with the most active applications first, returns the count
+size_t AppsTop(const AppTable* at, const AppEntry** entries, size_t max);
+
+// Stored next to the history, in P.app for the history base path P
+BOOL AppsLoad(AppTable* at, const char* const basePath);
+BOOL AppsSave(const AppTable* at);
+
+char* AppString(size_t rank);
@@ -0,0 +1,131 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "arexx.h"
+#include "command.h"
+#include "logger.h"
+
+#include <proto/exec.h>
+#include <proto/rexxsyslib.h>
+#include <rexx/storage.h>
+#include <rexx/errors.h>
+
+#include <string.h>
+
+// Public ARexx port. Commands are parsed and answered by command.c.
+
+static struct MsgPort* port;
+
+static void* NextMessage(void* queue, const char** line)
+{
+    struct Message* msg = IExec->GetMsg((struct MsgPort *)queue);
+
+    if (msg) {
+        *line = IRexxSys->IsRexxMsg(msg) ? (const char *)ARG0((struct RexxMsg *)msg) : NULL;
+    }
+
+    return msg;
+}
+
+// Anyone can send to a public port. Results are only set in RexxMsgs, for
+// which NextMessage() returned a command line; 'result' is NULL otherwise.
+static void ReplyMessage(void* queue, void* message, ECommandResult rc, const char* const result)
+{
+    (void)queue;
+
+    if (result) {
+        struct RexxMsg* msg = (struct RexxMsg *)message;
+
+        msg->rm_Result1 = rc;
+        msg->rm_Result2 = 0;
+
+        // A result string is only allowed on success, when the sender asked for one
+        if (rc == ECommandResult_Ok && (msg->rm_Action & RXFF_RESULT) && result[0]) {
+            msg->rm_Result2 = (int32)IRexxSys->CreateArgstring(result, strlen(result));
+        }
+    }
+
+    IExec->ReplyMsg((struct Message *)message);
+}
+
+BOOL ArexxInit()
+{
+    IExec->Forbid();
+    const BOOL exists = IExec->FindPort(AREXX_PORT_NAME) != NULL;
+    IExec->Permit();
+
+    if (exists) {
+        Log("ARexx port %s already exists", AREXX_PORT_NAME);
+        return FALSE;
+    }
+
+    port = IExec->AllocSysObjectTags(ASOT_PORT,
+        ASOPORT_Name, AREXX_PORT_NAME,
+        ASOPORT_Public, TRUE,
+        TAG_DONE);
+
+    if (!port) {
+        Log("Failed to create ARexx port");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void ArexxQuit()
+{
+    if (port) {
+        struct Message* msg;
+
+        IExec->Forbid();
+
+        while ((msg = IExec->GetMsg(port))) {
+            if (IRexxSys->IsRexxMsg(msg)) {
+                ((struct RexxMsg *)msg)->rm_Result1 = RC_FATAL;
+                ((struct RexxMsg *)msg)->rm_Result2 = 0;
+            }
+
+            IExec->ReplyMsg(msg);
+        }
+
+        IExec->FreeSysObject(ASOT_PORT, port);
+        port = NULL;
+
+        IExec->Permit();
+    }
+}
+
+uint32 ArexxSignal()
+{
+    return port ? 1L << port->mp_SigBit : 0;
+}
+
+void ArexxHandleEvents()
+{
+    if (port) {
+        CommandServiceQueue(port, NextMessage, ReplyMessage);
+    }
+}
@@ -0,0 +1,68 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "calendar.h"
+
+// Howard Hinnant's days_from_civil / civil_from_days, limited to dates
+// after 1970
+
+CalendarDate CalendarFromDay(uint32 day)
+{
+    const int32 z = (int32)day + 719468;
+    const int32 era = z / 146097;
+    const int32 doe = z - era * 146097;
+    const int32 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int32 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int32 mp = (5 * doy + 2) / 153;
+
+    CalendarDate date;
+
+    date.day = doy - (153 * mp + 2) / 5 + 1;
+    date.month = mp < 10 ? mp + 3 : mp - 9;
+    date.year = yoe + era * 400 + (date.month <= 2);
+
+    return date;
+}
+
+uint32 CalendarToDay(const CalendarDate* date)
+{
+    const int32 y = date->year - (date->month <= 2);
+    const int32 era = y / 400;
+    const int32 yoe = y - era * 400;
+    const int32 mp = date->month > 2 ? date->month - 3 : date->month + 9;
+    const int32 doy = (153 * mp + 2) / 5 + date->day - 1;
+    const int32 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return (uint32)(era * 146097 + doe - 719468);
+}
+
+uint32 CalendarMonthStart(uint32 day)
+{
+    CalendarDate date = CalendarFromDay(day);
+    date.day = 1;
+
+    return CalendarToDay(&date);
+}
@@ -0,0 +1,56 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "platform.h"
+
+// Day numbers count days since 1.1.1970 in local time
+
+#define SECONDS_PER_DAY (24 * 60 * 60)
+#define MINUTES_PER_DAY (24 * 60)
+
+typedef struct CalendarDate
+{
+    int year;
+    int month; // 1 - 12
+    int day; // 1 - 31
+} CalendarDate;
+
+// Monday is 0. 1.1.1970 was a Thursday.
+static inline uint32 CalendarWeekday(uint32 day)
+{
+    return (day + 3) % 7;
+}
+
+static inline uint32 CalendarWeekStart(uint32 day)
+{
+    return day - CalendarWeekday(day);
+}
+
+CalendarDate CalendarFromDay(uint32 day);
+uint32 CalendarToDay(const CalendarDate* date);
+uint32 CalendarMonthStart(uint32 day);
@@ -0,0 +1,114 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "clock.h"
+
+static uint64 VirtualNow(Clock* clock)
+{
+    return clock->time;
+}
+
+void VirtualClockInit(Clock* clock, uint64 start)
+{
+    clock->Now = VirtualNow;
+    clock->time = start;
+}
+
+void VirtualClockSet(Clock* clock, uint64 time)
+{
+    if (time > clock->time) {
+        clock->time = time;
+    }
+}
+
+void VirtualClockAdvance(Clock* clock, uint64 micros)
+{
+    clock->time += micros;
+}
+
+int64 localOffset;
+
+// The clocks are read one after the other, so differences below two
+// seconds are only rounding
+BOOL LocalOffsetUpdate()
+{
+    const uint64 wall = ClockNow(WallClock());
+    const uint64 monotonic = ClockNow(MonotonicClock());
+    const int64 offset = ((int64)wall - (int64)monotonic + 500000) / 1000000;
+    const int64 change = offset - localOffset;
+
+    if (change > -2 && change < 2) {
+        return FALSE;
+    }
+
+    localOffset = offset;
+
+    return TRUE;
+}
+
+#ifndef __amigaos4__
+
+// Host implementations, the Amiga ones live in timer.c
+
+#include <time.h>
+
+static uint64 HostMonotonicNow(Clock* clock)
+{
+    (void)clock;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64 HostWallNow(Clock* clock)
+{
+    (void)clock;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    struct tm local;
+    const time_t seconds = ts.tv_sec;
+    localtime_r(&seconds, &local);
+
+    return (uint64)(ts.tv_sec + local.tm_gmtoff) * 1000000 + ts.tv_nsec / 1000;
+}
+
+Clock* MonotonicClock()
+{
+    static Clock clock = { HostMonotonicNow, 0 };
+    return &clock;
+}
+
+Clock* WallClock()
+{
+    static Clock clock = { HostWallNow, 0 };
+    return &clock;
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "platform.h"
+
+// Time sources used by the statistics engine. All of them return
+// microseconds.
+//
+// MonotonicClock() never jumps and is used for measuring durations.
+// WallClock() is local time since 1.1.1970 and is used only for calendar
+// boundaries. A virtual clock is stepped explicitly, for replay and
+// simulation.
+
+typedef struct Clock
+{
+    uint64 (*Now)(struct Clock* clock);
+    uint64 time;
+} Clock;
+
+static inline uint64 ClockNow(Clock* clock)
+{
+    return clock->Now(clock);
+}
+
+static inline uint32 ClockSeconds(Clock* clock)
+{
+    return (uint32)(ClockNow(clock) / 1000000);
+}
+
+void VirtualClockInit(Clock* clock, uint64 start);
+void VirtualClockSet(Clock* clock, uint64 time);
+void VirtualClockAdvance(Clock* clock, uint64 micros);
+
+Clock* MonotonicClock();
+Clock* WallClock();
+
+// Seconds from MonotonicClock() to local time. The wall clock moves against
+// the monotonic one with a DST change or when the time is set after boot,
+// so LocalOffsetUpdate() re-derives it and tells whether it changed.
+extern int64 localOffset;
+
+BOOL LocalOffsetUpdate();
@@ -0,0 +1,54 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+// Optional input handler stages, chosen at build time. A disabled stage is
+// compiled out of the handler: its per-event code and branches are gone and
+// its Counter fields stay zero. Activity, keys and relative mouse movement
+// are always counted because the statistics depend on them.
+//
+// Override from the makefile, e.g. make COLLECT_GESTURES=0 (after a clean).
+
+// Per-button click counters
+#ifndef COLLECT_BUTTONS
+#define COLLECT_BUTTONS 1
+#endif
+
+// Absolute positions from tablets, touchscreens and IECLASS_POINTERPOS
+#ifndef COLLECT_POINTERS
+#define COLLECT_POINTERS 1
+#endif
+
+// Clicks, double-clicks and drags
+#ifndef COLLECT_GESTURES
+#define COLLECT_GESTURES 1
+#endif
+
+// Copying events into the journal ring for RECORD
+#ifndef COLLECT_JOURNAL
+#define COLLECT_JOURNAL 1
+#endif
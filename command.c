@@ -0,0 +1,360 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "command.h"
+#include "history.h"
+#include "minuteindex.h"
+#include "rollup.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ARGS 6
+
+typedef enum EValue {
+    EValue_Active,
+    EValue_Current,
+    EValue_Break,
+    EValue_Breaks,
+    EValue_Left,
+    EValue_Middle,
+    EValue_Right,
+    EValue_Fourth,
+    EValue_Fifth,
+    EValue_Keys,
+    EValue_Pixels,
+    EValue_Today,
+    EValue_Count // KEEP LAST
+} EValue;
+
+static const char* const valueNames[EValue_Count] = {
+    "ACTIVE",
+    "CURRENT",
+    "BREAK",
+    "BREAKS",
+    "LEFT",
+    "MIDDLE",
+    "RIGHT",
+    "FOURTH",
+    "FIFTH",
+    "KEYS",
+    "PIXELS",
+    "TODAY"
+};
+
+// Current and break durations are not counters, so RESET leaves them be
+static const BOOL resettable[EValue_Count] = {
+    TRUE, FALSE, FALSE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, FALSE
+};
+
+static const Counter* counter;
+static Clock* clock;
+static const int64* offset;
+static const char* historyPath;
+static CommandFlush flush;
+static uint64 baseline[EValue_Count];
+
+static BOOL Equal(const char* a, const char* b)
+{
+    while (*a && *b && toupper((unsigned char)*a) == toupper((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+
+    return *a == *b;
+}
+
+static int Find(const char* const name, const char* const* names, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (Equal(name, names[i])) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static BOOL ParseNumber(const char* const string, uint32* value)
+{
+    char* end;
+    const unsigned long number = strtoul(string, &end, 10);
+
+    if (end == string || *end || number > 0xFFFFFFFFUL) {
+        return FALSE;
+    }
+
+    *value = (uint32)number;
+
+    return TRUE;
+}
+
+static void ReadValues(uint64* values)
+{
+    StatsSummary summary;
+    StatsGetSummary(&summary);
+
+    values[EValue_Active] = summary.activeSecondsTotal;
+    values[EValue_Current] = summary.activeSeconds;
+    values[EValue_Break] = summary.breakSeconds;
+    values[EValue_Breaks] = summary.breaks;
+    values[EValue_Left] = counter->left;
+    values[EValue_Middle] = counter->middle;
+    values[EValue_Right] = counter->right;
+    values[EValue_Fourth] = counter->fourth;
+    values[EValue_Fifth] = counter->fifth;
+    values[EValue_Keys] = counter->keys;
+    values[EValue_Pixels] = counter->pixels;
+    values[EValue_Today] = RollupsGet(&rollups, EPeriod_Day, 0)->values[EMetric_Active];
+
+    for (int i = 0; i < EValue_Count; i++) {
+        values[i] -= baseline[i];
+    }
+}
+
+static ECommandResult Get(char** args, int count, char* result, size_t size)
+{
+    uint64 values[EValue_Count];
+    int value;
+
+    if (count != 2 || (value = Find(args[1], valueNames, EValue_Count)) < 0) {
+        snprintf(result, size, "Usage: GET <name>");
+        return ECommandResult_Error;
+    }
+
+    ReadValues(values);
+    snprintf(result, size, "%llu", (unsigned long long)values[value]);
+
+    return ECommandResult_Ok;
+}
+
+static ECommandResult Snapshot(char** args, int count, char* result, size_t size)
+{
+    uint64 values[EValue_Count];
+    size_t len = 0;
+
+    (void)args;
+
+    if (count != 1) {
+        snprintf(result, size, "Usage: SNAPSHOT");
+        return ECommandResult_Error;
+    }
+
+    ReadValues(values);
+
+    for (int i = 0; i < EValue_Count && len < size; i++) {
+        len += snprintf(result + len, size - len, "%s%s=%llu", i ? " " : "", valueNames[i],
+            (unsigned long long)values[i]);
+    }
+
+    return ECommandResult_Ok;
+}
+
+static void AddValue(uint32 minute, uint32 value, void* userData)
+{
+    (void)minute;
+
+    *(uint64 *)userData += value;
+}
+
+static ECommandResult HistorySums(char** args, int count, char* result, size_t size)
+{
+    uint32 from, to = 0, step = 0;
+    int metric;
+
+    if (count < 3 || count > 5 || (metric = Find(args[1], metricNames, EMetric_Count)) < 0 ||
+        !ParseNumber(args[2], &from) || (count > 3 && !ParseNumber(args[3], &to)) ||
+        (count > 4 && !ParseNumber(args[4], &step)) || to > from) {
+        snprintf(result, size, "Usage: HISTORY <metric> <from> [<to> [<step>]]");
+        return ECommandResult_Error;
+    }
+
+    if (!step) {
+        step = from - to;
+    }
+
+    if (!step || (from - to + step - 1) / step > COMMAND_MAX_STEPS) {
+        snprintf(result, size, "At most %d steps", COMMAND_MAX_STEPS);
+        return ECommandResult_Error;
+    }
+
+    // The current minute is still open
+    const uint32 now = (uint32)((ClockSeconds(clock) + *offset) / 60);
+    const uint32 oldest = MinuteIndexOldest(&minuteIndex);
+    HistoryReader* reader = NULL;
+    size_t len = 0;
+
+    // Minutes older than the index are read from the history
+    if (historyPath && now - from < oldest && (reader = malloc(sizeof(HistoryReader))) &&
+        !HistoryReaderOpen(reader, historyPath)) {
+        free(reader);
+        reader = NULL;
+    }
+
+    result[0] = '\0';
+
+    for (uint32 start = now - from; start < now - to && len < size; start += step) {
+        const uint32 end = start + step < now - to ? start + step : now - to;
+        uint64 sum = MinuteIndexSum(&minuteIndex, (EMetric)metric, start, end);
+
+        if (reader && start < oldest) {
+            HistoryReaderMetric(reader, (EMetric)metric, start, end < oldest ? end : oldest, AddValue, &sum);
+        }
+
+        len += snprintf(result + len, size - len, "%s%llu", len ? " " : "", (unsigned long long)sum);
+    }
+
+    if (reader) {
+        HistoryReaderClose(reader);
+        free(reader);
+    }
+
+    return ECommandResult_Ok;
+}
+
+static ECommandResult Reset(char** args, int count, char* result, size_t size)
+{
+    uint64 values[EValue_Count];
+
+    (void)args;
+    (void)result;
+    (void)size;
+
+    if (count != 1) {
+        return ECommandResult_Error;
+    }
+
+    ReadValues(values);
+
+    for (int i = 0; i < EValue_Count; i++) {
+        if (resettable[i]) {
+            baseline[i] += values[i];
+        }
+    }
+
+    return ECommandResult_Ok;
+}
+
+static ECommandResult Flush(char** args, int count, char* result, size_t size)
+{
+    (void)args;
+    (void)result;
+    (void)size;
+
+    if (count != 1) {
+        return ECommandResult_Error;
+    }
+
+    if (flush) {
+        flush();
+    }
+
+    return ECommandResult_Ok;
+}
+
+typedef ECommandResult (*CommandFunction)(char** args, int count, char* result, size_t size);
+
+static const struct {
+    const char* name;
+    CommandFunction function;
+} commands[] = {
+    { "GET", Get },
+    { "SNAPSHOT", Snapshot },
+    { "HISTORY", HistorySums },
+    { "RESET", Reset },
+    { "FLUSH", Flush }
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+void CommandInit(const Counter* c, Clock* source, const int64* timeOffset, const char* const history,
+    CommandFlush flushFunction)
+{
+    counter = c;
+    clock = source;
+    offset = timeOffset;
+    historyPath = history;
+    flush = flushFunction;
+
+    memset(baseline, 0, sizeof(baseline));
+}
+
+ECommandResult CommandExecute(const char* const line, char* result, size_t size)
+{
+    char buffer[COMMAND_RESULT_SIZE];
+    char* args[MAX_ARGS];
+    int count = 0;
+
+    snprintf(buffer, sizeof(buffer), "%s", line);
+    result[0] = '\0';
+
+    for (char* token = strtok(buffer, " \t\r\n"); token; token = strtok(NULL, " \t\r\n")) {
+        if (count == MAX_ARGS) {
+            snprintf(result, size, "Too many arguments");
+            return ECommandResult_Error;
+        }
+
+        args[count++] = token;
+    }
+
+    if (!count) {
+        return ECommandResult_Warn;
+    }
+
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        if (Equal(args[0], commands[i].name)) {
+            return commands[i].function(args, count, result, size);
+        }
+    }
+
+    snprintf(result, size, "Unknown command '%s'", args[0]);
+
+    return ECommandResult_Error;
+}
+
+// Answers everything that's queued, so one wakeup serves a burst of
+// commands
+size_t CommandServiceQueue(void* queue, CommandNext next, CommandReply reply)
+{
+    char result[COMMAND_RESULT_SIZE];
+    const char* line;
+    void* message;
+    size_t served = 0;
+
+    while ((message = next(queue, &line))) {
+        if (line) {
+            reply(queue, message, CommandExecute(line, result, sizeof(result)), result);
+        } else {
+            reply(queue, message, ECommandResult_Error, NULL);
+        }
+
+        served++;
+    }
+
+    return served;
+}
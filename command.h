@@ -0,0 +1,68 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "common.h"
+
+// Text commands for scripts, as sent to the ACTIVITYMETER ARexx port:
+//
+// GET <name>                         - one value, see SNAPSHOT for names
+// SNAPSHOT                           - every value as NAME=value pairs
+// HISTORY <metric> <from> [<to> [<step>]]
+//                                    - metric sums over closed minutes,
+//                                      'from' and 'to' in minutes ago.
+//                                      With 'step' one sum per step.
+//                                      Minutes older than the minute
+//                                      index come from the history.
+// RESET                              - starts counting GET and SNAPSHOT
+//                                      values from zero
+// FLUSH                              - writes buffered recordings
+
+#define COMMAND_RESULT_SIZE 512
+#define COMMAND_MAX_STEPS 64
+
+// ARexx return codes
+typedef enum ECommandResult {
+    ECommandResult_Ok = 0,
+    ECommandResult_Warn = 5,
+    ECommandResult_Error = 10
+} ECommandResult;
+
+typedef void (*CommandFlush)(void);
+
+// A message queue: 'next' returns the next message and its command line,
+// or NULL when the queue is empty. The line is NULL for a message that
+// doesn't carry a command, which is not executed and is passed to 'reply'
+// with a NULL result. 'reply' returns a message to its sender.
+typedef void* (*CommandNext)(void* queue, const char** line);
+typedef void (*CommandReply)(void* queue, void* message, ECommandResult rc, const char* const result);
+
+// 'historyPath' is the history base path, or NULL without a history
+void CommandInit(const Counter* counter, Clock* clock, const int64* timeOffset, const char* const historyPath,
+    CommandFlush flush);
+ECommandResult CommandExecute(const char* const line, char* result, size_t size);
+size_t CommandServiceQueue(void* queue, CommandNext next, CommandReply reply);
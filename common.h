@@ -26,7 +26,62 @@ SOFTWARE.
 
 #pragma once
 
+#include "handler.h"
+#include "clock.h"
+#include "format.h"
+
+#define BREAK_LENGTH (5 * 60)
+
+typedef struct StatsTick
+{
+    size_t from;
+    size_t now;
+    size_t active;
+    size_t activeSeconds;
+    size_t breakSeconds;
+    const Counter* counter;
+} StatsTick;
+
+// Called for every accumulated step. The first 'active' seconds after
+// 'from' were active, the rest of the step was passive.
+typedef void (*StatsObserver)(const StatsTick* tick, void* userData);
+
+typedef struct StatsSummary
+{
+    size_t activeSecondsTotal;
+    size_t activeSeconds;
+    size_t breakSeconds;
+    size_t breaks;
+    size_t lastActive; // Clock seconds
+} StatsSummary;
+
+void InitStats(Counter* c, Clock* clock);
 void CalculateStats();
+BOOL StatsAddObserver(StatsObserver observer, void* userData);
+void StatsGetSummary(StatsSummary* summary);
+
+// When idle, the input handler signals the task on the first input until
+// the next CalculateStats(), so the caller can stop ticking meanwhile.
+// Returns FALSE if there's activity the ticks still have to account for.
+BOOL StatsSleep(void* task, uint32 signal);
+BOOL StatsSleeping();
+
+void FlushRecording();
+
+typedef enum EStatsString {
+    EStatsString_AllActivity,
+    EStatsString_CurrentActivity,
+    EStatsString_Break,
+    EStatsString_TotalBreaks,
+    EStatsString_MouseCounter,
+    EStatsString_KeyCounter,
+    EStatsString_Pixels,
+    EStatsString_IconTitle,
+    EStatsString_Count // KEEP LAST
+} EStatsString;
+
+// Reentrant, each caller keeps one cache per string
+const char* StatsFormat(EStatsString id, FormatCache* cache);
 
 char* AllActivityString();
 char* CurrentActivityString();
@@ -36,4 +91,5 @@ char* TotalBreaksString();
 char* MouseCounterString();
 char* KeyCounterString();
 char* PixelsString();
+char* IconTitleString();
 
@@ -0,0 +1,170 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "evdev.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#ifndef input_event_sec
+#define input_event_sec time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+void EvdevInit(EvdevSource* s, int fd)
+{
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+}
+
+static int16 Clamp(int32 value)
+{
+    return value < -32768 ? -32768 : value > 32767 ? 32767 : (int16)value;
+}
+
+static struct InputEvent* Emit(struct InputEvent* events, size_t* count, const struct input_event* record,
+    uint8 class, uint16 code)
+{
+    struct InputEvent* e = &events[(*count)++];
+
+    memset(e, 0, sizeof(*e));
+    e->ie_Class = class;
+    e->ie_Code = code;
+    e->ie_TimeStamp.Seconds = (uint32)record->input_event_sec;
+    e->ie_TimeStamp.Microseconds = (uint32)record->input_event_usec;
+
+    return e;
+}
+
+static uint16 MouseButton(uint16 code)
+{
+    switch (code) {
+        case BTN_LEFT: return IECODE_LBUTTON;
+        case BTN_RIGHT: return IECODE_RBUTTON;
+        case BTN_MIDDLE: return IECODE_MBUTTON;
+        case BTN_SIDE: return IECODE_4TH_BUTTON;
+        case BTN_EXTRA: return IECODE_5TH_BUTTON;
+        default: return IECODE_NOBUTTON;
+    }
+}
+
+// Keyboard keys are below BTN_MISC and from KEY_OK on. The buttons in
+// between belong to mice, joysticks and touch devices.
+static BOOL IsKey(uint16 code)
+{
+    return code < BTN_MISC || (code >= KEY_OK && code < KEY_MAX);
+}
+
+static void Flush(EvdevSource* s, size_t* events, Counter* counter)
+{
+    if (*events) {
+        for (size_t i = 0; i + 1 < *events; i++) {
+            s->events[i].ie_NextEvent = &s->events[i + 1];
+        }
+        s->events[*events - 1].ie_NextEvent = NULL;
+
+        InputEventHandler(s->events, counter);
+        *events = 0;
+    }
+}
+
+void EvdevDispatch(EvdevSource* s, const struct input_event* records, size_t count, Counter* counter)
+{
+    size_t events = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const struct input_event* r = &records[i];
+
+        if (events == EVDEV_BATCH) {
+            Flush(s, &events, counter);
+        }
+
+        switch (r->type) {
+            case EV_REL:
+                if (r->code == REL_X) {
+                    s->dx += r->value;
+                } else if (r->code == REL_Y) {
+                    s->dy += r->value;
+                }
+                break;
+
+            case EV_SYN:
+                // Motion is reported once per device report, like the Amiga does
+                if (r->code == SYN_REPORT && (s->dx || s->dy)) {
+                    struct InputEvent* e = Emit(s->events, &events, r, IECLASS_RAWMOUSE, IECODE_NOBUTTON);
+
+                    e->ie_X = Clamp(s->dx);
+                    e->ie_Y = Clamp(s->dy);
+                    s->dx = s->dy = 0;
+                }
+                break;
+
+            case EV_KEY: {
+                const uint16 button = MouseButton(r->code);
+                const uint16 up = r->value == 0 ? IECODE_UP_PREFIX : 0;
+
+                if (button != IECODE_NOBUTTON) {
+                    if (r->value != 2) {
+                        Emit(s->events, &events, r, IECLASS_RAWMOUSE, button | up);
+                    }
+                } else if (IsKey(r->code)) {
+                    struct InputEvent* e = Emit(s->events, &events, r, IECLASS_RAWKEY, (r->code & 0x7F) | up);
+
+                    if (r->value == 2) {
+                        e->ie_Qualifier = IEQUALIFIER_REPEAT;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    s->records += count;
+
+    Flush(s, &events, counter);
+}
+
+ssize_t EvdevRead(EvdevSource* s, Counter* counter)
+{
+    uint8* buffer = (uint8 *)s->raw;
+    const ssize_t len = read(s->fd, buffer + s->partial, sizeof(s->raw) - s->partial);
+
+    if (len <= 0) {
+        return len;
+    }
+
+    s->reads++;
+
+    const size_t bytes = s->partial + len;
+    const size_t count = bytes / sizeof(struct input_event);
+
+    EvdevDispatch(s, s->raw, count, counter);
+
+    s->partial = bytes - count * sizeof(struct input_event);
+    memmove(buffer, buffer + count * sizeof(struct input_event), s->partial);
+
+    return len;
+}
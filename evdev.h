@@ -0,0 +1,58 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "handler.h"
+
+#include <linux/input.h>
+#include <sys/types.h>
+
+// Linux input backend. Reads struct input_event records from any file
+// descriptor - an evdev node, a pipe or a recorded file - and feeds them
+// to InputEventHandler as Amiga input events, one handler call per read.
+
+#define EVDEV_BATCH 512
+
+typedef struct EvdevSource
+{
+    int fd;
+    int32 dx; // Relative motion since the last SYN_REPORT
+    int32 dy;
+    size_t partial; // Bytes of an incomplete record, from pipes
+    size_t reads;
+    size_t records;
+    struct input_event raw[EVDEV_BATCH];
+    struct InputEvent events[EVDEV_BATCH];
+} EvdevSource;
+
+void EvdevInit(EvdevSource* s, int fd);
+
+// Returns what read() returned: > 0 for data, 0 at end of file, -1 on error
+ssize_t EvdevRead(EvdevSource* s, Counter* counter);
+
+// Translates and dispatches records that were read some other way
+void EvdevDispatch(EvdevSource* s, const struct input_event* records, size_t count, Counter* counter);
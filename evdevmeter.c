@@ -0,0 +1,355 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Activity meter for Linux: counts input from evdev nodes, pipes or
+// recorded files with the same handler and statistics code as the Amiga
+// version, and optionally writes the same history files.
+
+#include "common.h"
+#include "evdev.h"
+#include "minutes.h"
+#include "history.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SOURCES 16
+#define BENCH_CHUNK 256 // Reports per write
+
+static volatile sig_atomic_t running = 1;
+
+static void Stop(int signal)
+{
+    (void)signal;
+    running = 0;
+}
+
+static double Elapsed(const struct timespec* since, clockid_t id)
+{
+    struct timespec now;
+    clock_gettime(id, &now);
+
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+static void PrintStats(void)
+{
+    puts(AllActivityString());
+    puts(CurrentActivityString());
+    puts(BreakString());
+    puts(TotalBreaksString());
+    puts(MouseCounterString());
+    puts(PixelsString());
+    puts(KeyCounterString());
+    fflush(stdout);
+}
+
+static void SetEvent(struct input_event* e, uint16 type, uint16 code, int32 value)
+{
+    memset(e, 0, sizeof(*e));
+    e->type = type;
+    e->code = code;
+    e->value = value;
+}
+
+typedef struct Bench
+{
+    int fd;
+    size_t reports;
+    BOOL failed;
+} Bench;
+
+// Reports of a fast mouse: motion on both axes, with a click and a key
+// press now and then
+static void* BenchWriter(void* userData)
+{
+    Bench* b = (Bench *)userData;
+    static struct input_event chunk[BENCH_CHUNK * 7];
+
+    for (size_t sent = 0; sent < b->reports && !b->failed; ) {
+        size_t n = 0;
+
+        for (size_t r = 0; r < BENCH_CHUNK && sent < b->reports; r++, sent++) {
+            SetEvent(&chunk[n++], EV_REL, REL_X, 3);
+            SetEvent(&chunk[n++], EV_REL, REL_Y, -4);
+
+            if (sent % 1000 == 0) {
+                SetEvent(&chunk[n++], EV_KEY, BTN_LEFT, 1);
+                SetEvent(&chunk[n++], EV_KEY, BTN_LEFT, 0);
+                SetEvent(&chunk[n++], EV_KEY, KEY_A, 1);
+                SetEvent(&chunk[n++], EV_KEY, KEY_A, 0);
+            }
+
+            SetEvent(&chunk[n++], EV_SYN, SYN_REPORT, 0);
+        }
+
+        const uint8* data = (const uint8 *)chunk;
+        size_t left = n * sizeof(chunk[0]);
+
+        while (left) {
+            const ssize_t written = write(b->fd, data, left);
+
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (written <= 0) {
+                perror("write");
+                b->failed = TRUE;
+                break;
+            }
+
+            data += written;
+            left -= written;
+        }
+    }
+
+    // The reader stops at end of file, also after a failed write
+    close(b->fd);
+
+    return NULL;
+}
+
+// Feeds a pipe with 'seconds' worth of reports at 'rate' Hz as fast as
+// possible and measures what the reading side costs
+static int RunBench(Counter* counter, uint32 seconds, uint32 rate)
+{
+    static EvdevSource source;
+    int fds[2];
+    pthread_t writer;
+    Bench bench;
+
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    bench.fd = fds[1];
+    bench.reports = (size_t)seconds * rate;
+    bench.failed = FALSE;
+
+    EvdevInit(&source, fds[0]);
+
+    struct timespec wall, cpu;
+    clock_gettime(CLOCK_MONOTONIC, &wall);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+
+    if (pthread_create(&writer, NULL, BenchWriter, &bench) != 0) {
+        puts("Failed to start the writer thread");
+        close(fds[1]);
+        close(fds[0]);
+        return 1;
+    }
+
+    while (EvdevRead(&source, counter) > 0) {
+    }
+
+    const double cpuTime = Elapsed(&cpu, CLOCK_THREAD_CPUTIME_ID);
+    const double wallTime = Elapsed(&wall, CLOCK_MONOTONIC);
+
+    pthread_join(writer, NULL);
+    close(fds[0]);
+
+    printf("%zu reports (%zu records) in %zu reads: %.3f s, %.0f records / second\n", bench.reports,
+        source.records, source.reads, wallTime, source.records / wallTime);
+    printf("Reader CPU per second of %u Hz input: %.1f us (%.3f%% of a core)\n", rate,
+        cpuTime * 1e6 / seconds, cpuTime * 100 / seconds);
+
+    if (bench.failed) {
+        return 1;
+    }
+
+    const size_t clicks = (bench.reports + 999) / 1000;
+
+    if (counter->pixels != bench.reports * 5 || counter->left != clicks || counter->keys != clicks) {
+        printf("Counter mismatch: %zu pixels, %zu clicks, %zu keys\n", counter->pixels, counter->left,
+            counter->keys);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Regular files can't be polled, so recordings are read in one go
+static BOOL ReadFile(EvdevSource* source, Counter* counter)
+{
+    ssize_t len;
+
+    while ((len = EvdevRead(source, counter)) > 0) {
+    }
+
+    close(source->fd);
+
+    return len == 0;
+}
+
+static void Usage(const char* const name)
+{
+    printf("Usage: %s [-interval <seconds>] [-history <base path>] <device|file|->...\n", name);
+    printf("       %s -bench <seconds> [-rate <Hz>]\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+    static Counter counter;
+    static EvdevSource sources[MAX_SOURCES];
+
+    uint32 interval = 60;
+    uint32 benchSeconds = 0;
+    uint32 rate = 8000;
+    const char* historyPath = NULL;
+    int first = 1;
+
+    for (; first < argc && argv[first][0] == '-' && argv[first][1]; first++) {
+        if (strcmp(argv[first], "-interval") == 0 && first + 1 < argc) {
+            interval = atoi(argv[++first]);
+        } else if (strcmp(argv[first], "-history") == 0 && first + 1 < argc) {
+            historyPath = argv[++first];
+        } else if (strcmp(argv[first], "-bench") == 0 && first + 1 < argc) {
+            benchSeconds = atoi(argv[++first]);
+        } else if (strcmp(argv[first], "-rate") == 0 && first + 1 < argc) {
+            rate = atoi(argv[++first]);
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (benchSeconds) {
+        return RunBench(&counter, benchSeconds, rate);
+    }
+
+    const int count = argc - first;
+
+    if (count < 1 || count > MAX_SOURCES || interval < 1) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    InitStats(&counter, MonotonicClock());
+
+    LocalOffsetUpdate();
+    MinutesInit(&minuteAggregator, &localOffset, &counter);
+    StatsAddObserver(MinutesOnTick, &minuteAggregator);
+
+    if (historyPath && HistoryInit(&history, historyPath)) {
+        MinutesAddObserver(&minuteAggregator, HistoryOnMinute, &history);
+    }
+
+    const int epoll = epoll_create1(0);
+    int polled = 0;
+    int stdinFlags = -1;
+
+    for (int i = 0; i < count; i++) {
+        const char* const path = argv[first + i];
+        const int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_NONBLOCK);
+
+        if (fd < 0) {
+            printf("Failed to open '%s': %s\n", path, strerror(errno));
+            continue;
+        }
+
+        // Like the opened nodes, so an idle pipe doesn't stall the stats.
+        // The flags are shared with whoever else has stdin, so they're
+        // restored at exit.
+        if (fd == STDIN_FILENO) {
+            stdinFlags = fcntl(fd, F_GETFL);
+
+            if (stdinFlags < 0 || fcntl(fd, F_SETFL, stdinFlags | O_NONBLOCK) < 0) {
+                printf("Failed to make stdin non-blocking: %s\n", strerror(errno));
+            }
+        }
+
+        EvdevInit(&sources[i], fd);
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &sources[i];
+
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) == 0) {
+            polled++;
+        } else if (errno == EPERM) {
+            ReadFile(&sources[i], &counter);
+        } else {
+            printf("Failed to poll '%s': %s\n", path, strerror(errno));
+            close(fd);
+        }
+    }
+
+    signal(SIGINT, Stop);
+    signal(SIGTERM, Stop);
+
+    size_t nextPrint = ClockSeconds(MonotonicClock()) + interval;
+
+    while (running && polled) {
+        struct epoll_event ready[MAX_SOURCES];
+        const int n = epoll_wait(epoll, ready, MAX_SOURCES, 1000);
+
+        for (int i = 0; i < n; i++) {
+            EvdevSource* source = (EvdevSource *)ready[i].data.ptr;
+            ssize_t len;
+
+            // Drain everything that's there, a batch per read
+            while ((len = EvdevRead(source, &counter)) > 0) {
+            }
+
+            if (len == 0 || (len < 0 && errno != EAGAIN && errno != EINTR)) {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, source->fd, NULL);
+                close(source->fd);
+                polled--;
+            }
+        }
+
+        // Follows DST and clock changes in the minute stamps
+        LocalOffsetUpdate();
+        CalculateStats();
+
+        if (ClockSeconds(MonotonicClock()) >= nextPrint) {
+            PrintStats();
+            nextPrint += interval;
+        }
+    }
+
+    close(epoll);
+
+    if (stdinFlags >= 0) {
+        fcntl(STDIN_FILENO, F_SETFL, stdinFlags);
+    }
+
+    CalculateStats();
+    MinutesFlush(&minuteAggregator);
+    PrintStats();
+
+    return 0;
+}
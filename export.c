@@ -0,0 +1,158 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "export.h"
+#include "calendar.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+typedef struct Exporter
+{
+    FILE* file;
+    EExportFormat format;
+    size_t length;
+    BOOL failed;
+    char buffer[EXPORT_BUFFER_SIZE];
+} Exporter;
+
+// Longest formatted record, with room to spare
+#define EXPORT_MAX_RECORD 256
+
+const char* const exportFormatNames[EExportFormat_Count] = { "csv", "json" };
+
+static void Flush(Exporter* e)
+{
+    if (e->length && !e->failed) {
+        e->failed = fwrite(e->buffer, 1, e->length, e->file) != e->length;
+    }
+
+    e->length = 0;
+}
+
+static void Append(Exporter* e, const char* const fmt, ...) __attribute__ ((format (printf, 2, 3)));
+
+static void Append(Exporter* e, const char* const fmt, ...)
+{
+    if (sizeof(e->buffer) - e->length < EXPORT_MAX_RECORD) {
+        Flush(e);
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    const int len = vsnprintf(e->buffer + e->length, sizeof(e->buffer) - e->length, fmt, ap);
+    va_end(ap);
+
+    if (len > 0) {
+        e->length += len < EXPORT_MAX_RECORD ? (size_t)len : EXPORT_MAX_RECORD - 1;
+    }
+}
+
+static void Header(Exporter* e)
+{
+    if (e->format == EExportFormat_Csv) {
+        Append(e, "time");
+        for (int i = 0; i < EMetric_Count; i++) {
+            Append(e, ",%s", metricNames[i]);
+        }
+        Append(e, "\n");
+    } else {
+        Append(e, "[");
+    }
+}
+
+static void Record(Exporter* e, const MinuteRecord* record, BOOL first)
+{
+    const uint32 minuteOfDay = record->minute % MINUTES_PER_DAY;
+    const CalendarDate date = CalendarFromDay(record->minute / MINUTES_PER_DAY);
+    const uint32* v = record->values;
+
+    if (e->format == EExportFormat_Csv) {
+        Append(e, "%04d-%02d-%02d %02u:%02u,%u,%u,%u,%u,%u,%u,%u,%u\n", date.year, date.month, date.day,
+            (unsigned)(minuteOfDay / 60), (unsigned)(minuteOfDay % 60), (unsigned)v[0], (unsigned)v[1],
+            (unsigned)v[2], (unsigned)v[3], (unsigned)v[4], (unsigned)v[5], (unsigned)v[6], (unsigned)v[7]);
+    } else {
+        Append(e, "%s\n  { \"time\": \"%04d-%02d-%02dT%02u:%02u\"", first ? "" : ",", date.year, date.month,
+            date.day, (unsigned)(minuteOfDay / 60), (unsigned)(minuteOfDay % 60));
+        for (int i = 0; i < EMetric_Count; i++) {
+            Append(e, ", \"%s\": %u", metricNames[i], (unsigned)v[i]);
+        }
+        Append(e, " }");
+    }
+}
+
+int32 ExportHistory(const char* const historyPath, const char* const outputPath, EExportFormat format,
+    uint32 from, uint32 to)
+{
+    static HistoryReader reader;
+    static Exporter exporter;
+    MinuteRecord record;
+    int32 records = 0;
+
+    if (!HistoryReaderOpen(&reader, historyPath)) {
+        printf("No history found at '%s'\n", historyPath);
+        return -1;
+    }
+
+    exporter.file = fopen(outputPath, "wb");
+
+    if (!exporter.file) {
+        printf("Failed to open '%s'\n", outputPath);
+        HistoryReaderClose(&reader);
+        return -1;
+    }
+
+    // The exporter's buffer is the only one
+    setvbuf(exporter.file, NULL, _IONBF, 0);
+
+    exporter.format = format;
+    exporter.length = 0;
+    exporter.failed = FALSE;
+
+    Header(&exporter);
+
+    HistoryReaderSeek(&reader, from);
+
+    while (!exporter.failed && HistoryReaderNext(&reader, &record) && record.minute < to) {
+        Record(&exporter, &record, records == 0);
+        records++;
+    }
+
+    if (format == EExportFormat_Json) {
+        Append(&exporter, "\n]\n");
+    }
+
+    Flush(&exporter);
+
+    HistoryReaderClose(&reader);
+
+    if (fclose(exporter.file) != 0 || exporter.failed) {
+        printf("Failed to write '%s'\n", outputPath);
+        return -1;
+    }
+
+    return records;
+}
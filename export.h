@@ -0,0 +1,48 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "history.h"
+
+// Streams a range of history to a CSV or JSON file. Records are formatted
+// into a fixed buffer that is written out whenever it fills, so the size
+// of the export doesn't matter.
+
+#define EXPORT_BUFFER_SIZE 32768
+#define EXPORT_ALL_MINUTES 0xFFFFFFFF
+
+typedef enum EExportFormat {
+    EExportFormat_Csv,
+    EExportFormat_Json,
+    EExportFormat_Count // KEEP LAST
+} EExportFormat;
+
+extern const char* const exportFormatNames[EExportFormat_Count];
+
+// Exports minutes [from, to). Returns the number of records or -1 on error.
+int32 ExportHistory(const char* const historyPath, const char* const outputPath, EExportFormat format,
+    uint32 from, uint32 to);
@@ -0,0 +1,93 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "format.h"
+
+#include <string.h>
+
+void FormatBegin(FormatBuilder* b, char* buffer, size_t size)
+{
+    b->cursor = buffer;
+    b->end = buffer + size - 1;
+}
+
+void FormatText(FormatBuilder* b, const char* const text, size_t length)
+{
+    const size_t room = b->end - b->cursor;
+
+    if (length > room) {
+        length = room;
+    }
+
+    memcpy(b->cursor, text, length);
+    b->cursor += length;
+}
+
+// Digits are produced from the right into a scratch buffer, two at a time
+void FormatNumber(FormatBuilder* b, uint64 value)
+{
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    char digits[20];
+    char* p = digits + sizeof(digits);
+
+    while (value >= 100) {
+        const unsigned pair = (unsigned)(value % 100) * 2;
+
+        value /= 100;
+        *--p = pairs[pair + 1];
+        *--p = pairs[pair];
+    }
+
+    if (value >= 10) {
+        *--p = pairs[value * 2 + 1];
+        *--p = pairs[value * 2];
+    } else {
+        *--p = (char)('0' + value);
+    }
+
+    FormatText(b, p, digits + sizeof(digits) - p);
+}
+
+void FormatEnd(FormatBuilder* b)
+{
+    *b->cursor = '\0';
+}
+
+BOOL FormatCacheStale(FormatCache* cache, const uint64* keys, size_t count)
+{
+    if (cache->valid && memcmp(cache->keys, keys, count * sizeof(keys[0])) == 0) {
+        return FALSE;
+    }
+
+    memcpy(cache->keys, keys, count * sizeof(keys[0]));
+    cache->valid = TRUE;
+
+    return TRUE;
+}
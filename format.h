@@ -0,0 +1,64 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "platform.h"
+
+#include <stddef.h>
+
+// Builds short status strings without printf. Labels are string literals
+// with their length known at compile time, numbers are converted by hand.
+// A FormatCache remembers the values a string was built from, so an
+// unchanged string isn't rebuilt. Nothing here uses static state, so
+// callers on different tasks just need their own caches.
+
+#define FORMAT_TEXT_SIZE 96
+#define FORMAT_MAX_KEYS 6
+
+// Label and its length, for string literals only
+#define FORMAT_LABEL(text) text, sizeof(text) - 1
+
+typedef struct FormatBuilder
+{
+    char* cursor;
+    char* end; // Room for the terminator is kept after this
+} FormatBuilder;
+
+typedef struct FormatCache
+{
+    BOOL valid;
+    uint64 keys[FORMAT_MAX_KEYS];
+    char text[FORMAT_TEXT_SIZE];
+} FormatCache;
+
+void FormatBegin(FormatBuilder* b, char* buffer, size_t size);
+void FormatText(FormatBuilder* b, const char* const text, size_t length);
+void FormatNumber(FormatBuilder* b, uint64 value);
+void FormatEnd(FormatBuilder* b);
+
+// Returns TRUE if the cache must be rebuilt for these keys, and remembers them
+BOOL FormatCacheStale(FormatCache* cache, const uint64* keys, size_t count);
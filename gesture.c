@@ -0,0 +1,100 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "gesture.h"
+#include "input.h"
+
+void GesturesOnMove(Gestures* g, uint32 pixels)
+{
+    switch (g->state) {
+        case EGestureState_Idle:
+            g->movePixels += pixels;
+            break;
+        case EGestureState_Pressed:
+            g->pressPixels += pixels;
+
+            if (g->pressPixels >= GESTURE_DRAG_PIXELS) {
+                g->state = EGestureState_Dragging;
+            }
+            break;
+        case EGestureState_Dragging:
+            g->pressPixels += pixels;
+            break;
+    }
+}
+
+static void Press(Gestures* g, uint16 button, uint64 time)
+{
+    g->state = EGestureState_Pressed;
+    g->button = button;
+    g->downTime = time;
+    g->pressPixels = 0;
+}
+
+static void Release(Gestures* g, uint64 time)
+{
+    if (g->state == EGestureState_Dragging) {
+        g->drags++;
+        g->dragPixels += g->pressPixels;
+        g->dragMicros += time > g->downTime ? time - g->downTime : 0;
+        g->lastClickButton = 0;
+    } else {
+        const uint32 doubleClick = g->doubleClickMicros ? g->doubleClickMicros : GESTURE_DOUBLE_CLICK_MICROS;
+
+        g->clicks++;
+
+        // The third click of a triple-click starts a new pair
+        if (g->lastClickButton == g->button && g->downTime - g->lastClickTime <= doubleClick) {
+            g->doubleClicks++;
+            g->lastClickButton = 0;
+        } else {
+            g->lastClickButton = g->button;
+            g->lastClickTime = g->downTime;
+        }
+    }
+
+    g->state = EGestureState_Idle;
+}
+
+// Other buttons pressed during a press are chords and don't start a
+// gesture of their own
+void GesturesOnButton(Gestures* g, uint16 code, uint64 time)
+{
+    const uint16 button = code & ~IECODE_UP_PREFIX;
+
+    if (button < IECODE_LBUTTON || button > IECODE_5TH_BUTTON) {
+        return;
+    }
+
+    if (!(code & IECODE_UP_PREFIX)) {
+        // A press of the held button means its release was lost
+        if (g->state == EGestureState_Idle || button == g->button) {
+            Press(g, button, time);
+        }
+    } else if (g->state != EGestureState_Idle && button == g->button) {
+        Release(g, time);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "platform.h"
+
+#include <stddef.h>
+
+// Sorts mouse activity into clicks, double-clicks, drags and free movement.
+// Each event costs a few comparisons, so this runs in the input handler.
+// A press that moves less than the drag threshold before its release is a
+// click. A click on the same button within the double-click time of the
+// previous click's press is a double-click.
+
+#define GESTURE_DRAG_PIXELS 4
+#define GESTURE_DOUBLE_CLICK_MICROS 500000
+
+typedef enum EGestureState {
+    EGestureState_Idle,
+    EGestureState_Pressed,
+    EGestureState_Dragging
+} EGestureState;
+
+// Starts out zeroed
+typedef struct Gestures
+{
+    uint32 doubleClickMicros; // 0 for the default
+    uint32 state;
+    uint16 button; // Code of the button being held
+    uint16 lastClickButton;
+    uint64 downTime; // Microseconds
+    uint64 lastClickTime;
+    uint32 pressPixels;
+    size_t clicks; // Both clicks of a double-click count here too
+    size_t doubleClicks;
+    size_t drags;
+    size_t dragPixels;
+    uint64 dragMicros;
+    size_t movePixels;
+} Gestures;
+
+void GesturesOnMove(Gestures* g, uint32 pixels);
+void GesturesOnButton(Gestures* g, uint16 code, uint64 time);
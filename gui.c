@@ -29,19 +29,33 @@ SOFTWARE.
 #include "timer.h"
 #include "version.h"
 #include "common.h"
+#include "config.h"
+#include "notify.h"
+#include "arexx.h"
+#include "rollup.h"
+#include "minutes.h"
+#include "calendar.h"
+#include "history.h"
+#include "metrics.h"
+#include "export.h"
+#include "apps.h"
 
 #include <proto/intuition.h>
 #include <proto/dos.h>
 #include <proto/exec.h>
 #include <proto/icon.h>
+#include <proto/asl.h>
 
 #include <classes/requester.h>
 #include <classes/window.h>
 #include <gadgets/layout.h>
 #include <gadgets/button.h>
+#include <gadgets/clicktab.h>
 #include <libraries/gadtools.h>
+#include <libraries/asl.h>
 
 #include <stdio.h>
+#include <string.h>
 
 enum EObject {
     OID_Window,
@@ -53,11 +67,18 @@ enum EObject {
     OID_Breaks,
     OID_MouseCounter,
     OID_KeyCounter,
+    OID_Pages,
+    OID_Today,
+    OID_Yesterday,
+    OID_DailyAverage,
+    OID_Apps,
+    OID_AppsLast = OID_Apps + APPS_SHOWN - 1,
     OID_Count // KEEP LAST
 };
 
 typedef enum EMenu {
     MID_Iconify = 1,
+    MID_Export,
     MID_About,
     MID_Quit
 } EMenu;
@@ -65,27 +86,54 @@ typedef enum EMenu {
 static struct NewMenu menus[] = {
     { NM_TITLE, "Activity meter", NULL, 0, 0, NULL },
     { NM_ITEM, "Iconify", "I", 0, 0, (APTR)MID_Iconify },
+    { NM_ITEM, "Export...", "E", 0, 0, (APTR)MID_Export },
     { NM_ITEM, "About...", "?", 0, 0, (APTR)MID_About },
     { NM_ITEM, "Quit", "Q", 0, 0, (APTR)MID_Quit },
     { NM_END, NULL, NULL, 0, 0, NULL }
 };
 
+typedef enum EPage {
+    PAGE_Session,
+    PAGE_Daily,
+    PAGE_Applications
+} EPage;
+
+static STRPTR pageLabels[] = { "Session", "Daily", "Applications", NULL };
+
 static Object* objects[OID_Count];
 static struct Window* window;
 static struct MsgPort* port;
 
-static const ULONG seconds = 1;
-static const ULONG micros = 0;
+static const uint64 refreshPeriod = 1000000;
+static const uint64 refreshSlack = 100000;
+static const uint64 sleepingRefreshPeriod = 60 * 1000000ULL;
+static const uint64 sleepingRefreshSlack = 5 * 1000000ULL;
+static const size_t iconTitleInterval = 60;
+static const uint64 journalFlushPeriod = 1000000;
+static const uint64 journalFlushSlack = 1000000;
+static const uint64 reminderSlack = 1000000;
+static const uint64 midnightSlack = 1000000;
+static const uint64 compactionPeriod = 10 * 60 * 1000000ULL;
+static const uint64 compactionBacklogDelay = 1000000;
+static const uint64 compactionSlack = 60 * 1000000ULL;
+static const uint64 metricsSlack = 1000000;
+
+static Reminder reminder;
+
+static int8 wakeSignal = -1;
+static BOOL sleeping;
 
 static struct ClassLibrary* WindowBase;
 static struct ClassLibrary* RequesterBase;
 static struct ClassLibrary* ButtonBase;
 static struct ClassLibrary* LayoutBase;
+static struct ClassLibrary* ClickTabBase;
 
 static Class* WindowClass;
 static Class* RequesterClass;
 static Class* ButtonClass;
 static Class* LayoutClass;
+static Class* ClickTabClass;
 
 static void OpenClasses()
 {
@@ -110,6 +158,11 @@ static void OpenClasses()
     if (!LayoutBase) {
         puts("Failed to open layout.gadget");
     }
+
+    ClickTabBase = IIntuition->OpenClass("gadgets/clicktab.gadget", version, &ClickTabClass);
+    if (!ClickTabBase) {
+        puts("Failed to open clicktab.gadget");
+    }
 }
 
 static void CloseClasses()
@@ -118,6 +171,7 @@ static void CloseClasses()
     IIntuition->CloseClass(RequesterBase);
     IIntuition->CloseClass(ButtonBase);
     IIntuition->CloseClass(LayoutBase);
+    IIntuition->CloseClass(ClickTabBase);
 }
 
 static char* GetApplicationName()
@@ -169,6 +223,96 @@ static void ShowAboutWindow()
     }
 }
 
+// Returns the number of the chosen gadget, the rightmost one is 0
+static uint32 ShowRequester(const char* const title, const char* const body, const char* const gadgets,
+    uint32 image)
+{
+    uint32 result = 0;
+
+    Object* requester = IIntuition->NewObject(RequesterClass, NULL,
+        REQ_TitleText, title,
+        REQ_BodyText, body,
+        REQ_GadgetText, gadgets,
+        REQ_Image, image,
+        TAG_DONE);
+
+    if (requester) {
+        IIntuition->SetAttrs(objects[OID_Window], WA_BusyPointer, TRUE, TAG_DONE);
+        result = IIntuition->IDoMethod(requester, RM_OPENREQ, NULL, window, NULL, TAG_DONE);
+        IIntuition->SetAttrs(objects[OID_Window], WA_BusyPointer, FALSE, TAG_DONE);
+        IIntuition->DisposeObject(requester);
+    }
+
+    return result;
+}
+
+static BOOL AskExportPath(char* path, size_t size)
+{
+    BOOL ok = FALSE;
+
+    struct FileRequester* fr = IAsl->AllocAslRequestTags(ASL_FileRequest,
+        ASLFR_TitleText, "Export history",
+        ASLFR_Window, window,
+        ASLFR_DoSaveMode, TRUE,
+        ASLFR_InitialFile, "activity.csv",
+        TAG_DONE);
+
+    if (fr) {
+        if (IAsl->AslRequestTags(fr, TAG_DONE)) {
+            snprintf(path, size, "%s", fr->fr_Drawer);
+            ok = IDOS->AddPart(path, fr->fr_File, size);
+        }
+
+        IAsl->FreeAslRequest(fr);
+    }
+
+    return ok;
+}
+
+static size_t LocalSeconds(void)
+{
+    return ClockSeconds(MonotonicClock()) + localOffset;
+}
+
+static void ExportDialog()
+{
+    enum { ERange_Cancel, ERange_Today, ERange_Week, ERange_Month, ERange_All };
+
+    char path[1024];
+    char text[128];
+
+    if (!config.historyPath) {
+        ShowRequester("Export", "History isn't being recorded.", "_Ok", REQIMAGE_WARNING);
+        return;
+    }
+
+    const uint32 range = ShowRequester("Export", "Which minutes should be exported?",
+        "_Today|_Week|_Month|_All|_Cancel", REQIMAGE_QUESTION);
+
+    if (range == ERange_Cancel || !AskExportPath(path, sizeof(path))) {
+        return;
+    }
+
+    const uint32 now = LocalSeconds() / 60;
+    const uint32 from[] = { 0, now / MINUTES_PER_DAY * MINUTES_PER_DAY, now - 7 * MINUTES_PER_DAY,
+        now - 30 * MINUTES_PER_DAY, 0 };
+
+    const size_t len = strlen(path);
+    const EExportFormat format = len > 5 && strcasecmp(path + len - 5, ".json") == 0 ?
+        EExportFormat_Json : EExportFormat_Csv;
+
+    IIntuition->SetAttrs(objects[OID_Window], WA_BusyPointer, TRUE, TAG_DONE);
+    const int32 records = ExportHistory(config.historyPath, path, format, from[range], EXPORT_ALL_MINUTES);
+    IIntuition->SetAttrs(objects[OID_Window], WA_BusyPointer, FALSE, TAG_DONE);
+
+    if (records < 0) {
+        snprintf(text, sizeof(text), "Failed to export to %s.", path);
+        ShowRequester("Export", text, "_Ok", REQIMAGE_ERROR);
+    } else {
+        Log("Exported %ld minutes to '%s'", records, path);
+    }
+}
+
 static Object* CreateGui()
 {
     return IIntuition->NewObject(WindowClass, NULL,
@@ -189,54 +333,117 @@ static Object* CreateGui()
         WINDOW_NewMenu, menus,
         WINDOW_Layout, IIntuition->NewObject(LayoutClass, NULL,
             LAYOUT_Orientation, LAYOUT_ORIENT_VERT,
-            LAYOUT_AddChild, IIntuition->NewObject(LayoutClass, NULL,
-                LAYOUT_Orientation, LAYOUT_ORIENT_VERT,
-                LAYOUT_Label, "Information",
-                LAYOUT_BevelStyle, BVS_GROUP,
-                LAYOUT_AddChild, objects[OID_AllActivity] = IIntuition->NewObject(ButtonClass, NULL,
-                    GA_ReadOnly, TRUE,
-                    GA_Text, AllActivityString(),
-                    BUTTON_BevelStyle, BVS_NONE,
-                    BUTTON_Transparent, TRUE,
-                    TAG_DONE),
-                LAYOUT_AddChild, objects[OID_CurrentActivity] = IIntuition->NewObject(ButtonClass, NULL,
-                    GA_ReadOnly, TRUE,
-                    GA_Text, CurrentActivityString(),
-                    BUTTON_BevelStyle, BVS_NONE,
-                    BUTTON_Transparent, TRUE,
-                    TAG_DONE),
-                LAYOUT_AddChild, objects[OID_BreakDuration] = IIntuition->NewObject(ButtonClass, NULL,
-                    GA_ReadOnly, TRUE,
-                    GA_Text, BreakString(),
-                    BUTTON_BevelStyle, BVS_NONE,
-                    BUTTON_Transparent, TRUE,
-                    TAG_DONE),
-                LAYOUT_AddChild, objects[OID_Breaks] = IIntuition->NewObject(ButtonClass, NULL,
-                    GA_ReadOnly, TRUE,
-                    GA_Text, TotalBreaksString(),
-                    BUTTON_BevelStyle, BVS_NONE,
-                    BUTTON_Transparent, TRUE,
-                    TAG_DONE),
-                LAYOUT_AddChild, objects[OID_MouseCounter] = IIntuition->NewObject(ButtonClass, NULL,
-                    GA_ReadOnly, TRUE,
-                    GA_Text, MouseCounterString(),
-                    BUTTON_BevelStyle, BVS_NONE,
-                    BUTTON_Transparent, TRUE,
-                    TAG_DONE),
-                LAYOUT_AddChild, objects[OID_Pixels] = IIntuition->NewObject(ButtonClass, NULL,
-                    GA_ReadOnly, TRUE,
-                    GA_Text, PixelsString(),
-                    BUTTON_BevelStyle, BVS_NONE,
-                    BUTTON_Transparent, TRUE,
-                    TAG_DONE),
-                LAYOUT_AddChild, objects[OID_KeyCounter] = IIntuition->NewObject(ButtonClass, NULL,
-                    GA_ReadOnly, TRUE,
-                    GA_Text, KeyCounterString(),
-                    BUTTON_BevelStyle, BVS_NONE,
-                    BUTTON_Transparent, TRUE,
-                    TAG_DONE),
-                TAG_DONE), // vertical layout.gadget
-
+            LAYOUT_AddChild, IIntuition->NewObject(ClickTabClass, NULL,
+                GA_Text, pageLabels,
+                CLICKTAB_Current, PAGE_Session,
+                CLICKTAB_PageGroup, objects[OID_Pages] = IIntuition->NewObject(NULL, "page.gadget",
+                    PAGE_Add, IIntuition->NewObject(LayoutClass, NULL,
+                        LAYOUT_Orientation, LAYOUT_ORIENT_VERT,
+                        LAYOUT_Label, "Information",
+                        LAYOUT_BevelStyle, BVS_GROUP,
+                        LAYOUT_AddChild, objects[OID_AllActivity] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, AllActivityString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_CurrentActivity] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, CurrentActivityString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_BreakDuration] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, BreakString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_Breaks] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, TotalBreaksString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_MouseCounter] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, MouseCounterString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_Pixels] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, PixelsString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_KeyCounter] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, KeyCounterString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        TAG_DONE), // session page
+                    PAGE_Add, IIntuition->NewObject(LayoutClass, NULL,
+                        LAYOUT_Orientation, LAYOUT_ORIENT_VERT,
+                        LAYOUT_Label, "Daily activity",
+                        LAYOUT_BevelStyle, BVS_GROUP,
+                        LAYOUT_AddChild, objects[OID_Today] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, TodayString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_Yesterday] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, YesterdayString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_DailyAverage] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, DailyAverageString(),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        TAG_DONE), // daily page
+                    PAGE_Add, IIntuition->NewObject(LayoutClass, NULL,
+                        LAYOUT_Orientation, LAYOUT_ORIENT_VERT,
+                        LAYOUT_Label, "Most active applications",
+                        LAYOUT_BevelStyle, BVS_GROUP,
+                        LAYOUT_AddChild, objects[OID_Apps + 0] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, AppString(0),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_Apps + 1] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, AppString(1),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_Apps + 2] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, AppString(2),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_Apps + 3] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, AppString(3),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        LAYOUT_AddChild, objects[OID_Apps + 4] = IIntuition->NewObject(ButtonClass, NULL,
+                            GA_ReadOnly, TRUE,
+                            GA_Text, AppString(4),
+                            BUTTON_BevelStyle, BVS_NONE,
+                            BUTTON_Transparent, TRUE,
+                            TAG_DONE),
+                        TAG_DONE), // applications page
+                    TAG_DONE), // page.gadget
+                TAG_DONE), // clicktab.gadget
             TAG_DONE), // vertical layout.gadget
         TAG_DONE); // window.class
 }
@@ -248,7 +455,8 @@ static void RefreshObject(Object * object)
 
 static void Refresh()
 {
-    CalculateStats();
+    uint32 page = PAGE_Session;
+    IIntuition->GetAttr(PAGE_Current, objects[OID_Pages], &page);
 
     IIntuition->SetAttrs(objects[OID_MouseCounter], GA_Text, MouseCounterString(), TAG_DONE);
     IIntuition->SetAttrs(objects[OID_KeyCounter], GA_Text, KeyCounterString(), TAG_DONE);
@@ -259,25 +467,251 @@ static void Refresh()
     IIntuition->SetAttrs(objects[OID_BreakDuration], GA_Text, BreakString(), TAG_DONE);
     IIntuition->SetAttrs(objects[OID_Breaks], GA_Text, TotalBreaksString(), TAG_DONE);
 
-    RefreshObject(objects[OID_MouseCounter]);
-    RefreshObject(objects[OID_KeyCounter]);
-    RefreshObject(objects[OID_Pixels]);
+    IIntuition->SetAttrs(objects[OID_Today], GA_Text, TodayString(), TAG_DONE);
+    IIntuition->SetAttrs(objects[OID_Yesterday], GA_Text, YesterdayString(), TAG_DONE);
+    IIntuition->SetAttrs(objects[OID_DailyAverage], GA_Text, DailyAverageString(), TAG_DONE);
+
+    for (size_t i = 0; i < APPS_SHOWN; i++) {
+        IIntuition->SetAttrs(objects[OID_Apps + i], GA_Text, AppString(i), TAG_DONE);
+    }
+
+    // Gadgets on hidden pages are drawn when their page is shown
+    if (page == PAGE_Session) {
+        RefreshObject(objects[OID_MouseCounter]);
+        RefreshObject(objects[OID_KeyCounter]);
+        RefreshObject(objects[OID_Pixels]);
+
+        RefreshObject(objects[OID_AllActivity]);
+        RefreshObject(objects[OID_CurrentActivity]);
+        RefreshObject(objects[OID_BreakDuration]);
+        RefreshObject(objects[OID_Breaks]);
+    } else if (page == PAGE_Daily) {
+        RefreshObject(objects[OID_Today]);
+        RefreshObject(objects[OID_Yesterday]);
+        RefreshObject(objects[OID_DailyAverage]);
+    } else if (page == PAGE_Applications) {
+        for (size_t i = 0; i < APPS_SHOWN; i++) {
+            RefreshObject(objects[OID_Apps + i]);
+        }
+    }
+}
+
+static void MidnightTimer(void* userData);
+
+static void ScheduleMidnight(void)
+{
+    const size_t now = LocalSeconds();
+    const size_t midnight = (now / SECONDS_PER_DAY + 1) * SECONDS_PER_DAY;
+
+    TimerQueueSchedule(&timerQueue, ETimer_Midnight, (uint64)(midnight - now) * 1000000, 0, midnightSlack,
+        MidnightTimer, NULL);
+}
+
+// The wall clock may have moved against the monotonic one: a DST change, or
+// the time set after boot when network time arrives late
+static void FollowLocalTime(void)
+{
+    const int64 previous = localOffset;
+
+    if (LocalOffsetUpdate()) {
+        Log("Local time moved by %lld seconds", (long long)(localOffset - previous));
+        RollupsAdvance(&rollups, LocalSeconds() / SECONDS_PER_DAY);
+        ScheduleMidnight();
+    }
+}
+
+// Archives the day even if there's no further activity
+static void MidnightTimer(void* userData)
+{
+    (void)userData;
+
+    FollowLocalTime();
+    CalculateStats();
+    RollupsAdvance(&rollups, LocalSeconds() / SECONDS_PER_DAY);
 
-    RefreshObject(objects[OID_AllActivity]);
-    RefreshObject(objects[OID_CurrentActivity]);
-    RefreshObject(objects[OID_BreakDuration]);
-    RefreshObject(objects[OID_Breaks]);
+    ScheduleMidnight();
+}
+
+// One block per run so that a long backlog doesn't stall the GUI
+static void CompactionTimer(void* userData)
+{
+    (void)userData;
+
+    const BOOL backlog = HistoryCompact(&history);
+
+    if (!backlog && !AppsSave(&appTable)) {
+        Log("Failed to save application activity to '%s'", appTable.path);
+    }
+
+    TimerQueueSchedule(&timerQueue, ETimer_Compaction, backlog ? compactionBacklogDelay : compactionPeriod, 0,
+        compactionSlack, CompactionTimer, NULL);
+}
+
+static void MetricsTimer(void* userData)
+{
+    (void)userData;
+
+    MetricsWrite();
+}
+
+static void ReminderTimer(void* userData);
+
+static void ScheduleReminder(void)
+{
+    const uint32 delay = ReminderDelay(&reminder);
+
+    if (delay == REMINDER_NEVER) {
+        TimerQueueCancel(&timerQueue, ETimer_Reminder);
+    } else {
+        TimerQueueSchedule(&timerQueue, ETimer_Reminder, (uint64)delay * 1000000, 0, reminderSlack,
+            ReminderTimer, NULL);
+    }
+}
+
+static void ReminderTimer(void* userData)
+{
+    (void)userData;
+
+    static char text[128];
+
+    CalculateStats();
+
+    switch (ReminderCheck(&reminder)) {
+        case EReminder_MicroPause:
+            snprintf(text, sizeof(text), "%lu minutes of continuous activity. Time for a short pause.",
+                config.reminder.microPauseAfter);
+            NotifyShow("Micro-pause", text);
+            break;
+        case EReminder_LongBreak:
+            snprintf(text, sizeof(text), "%lu minutes of activity in the last %lu minutes. Time for a break.",
+                config.reminder.longBreakAfter, config.reminder.longBreakWindow);
+            NotifyShow("Break", text);
+            break;
+        case EReminder_None:
+            break;
+    }
+
+    ScheduleReminder();
+}
+
+// The AppIcon label changes at most once a minute, and only if its text does
+static void UpdateIconTitle(BOOL force)
+{
+    static char title[FORMAT_TEXT_SIZE];
+    static size_t updated;
+
+    const size_t now = ClockSeconds(MonotonicClock());
+
+    if (!force && now - updated < iconTitleInterval) {
+        return;
+    }
+
+    const char* text = IconTitleString();
+
+    if (strcmp(text, title) != 0) {
+        snprintf(title, sizeof(title), "%s", text);
+        IIntuition->SetAttrs(objects[OID_Window], WINDOW_IconTitle, title, TAG_DONE);
+        updated = now;
+    }
+}
+
+static void RefreshTimer(void* userData);
+
+// Iconified and idle, the refresh only keeps the icon label current and the
+// input handler wakes us up on the next input
+static void ScheduleRefresh(void)
+{
+    const BOOL sleep = !window && wakeSignal != -1 && StatsSleep(IExec->FindTask(NULL), 1UL << wakeSignal);
+
+    if (sleep != sleeping) {
+        sleeping = sleep;
+
+        if (sleeping) {
+            TimerQueueSchedule(&timerQueue, ETimer_Refresh, sleepingRefreshPeriod, sleepingRefreshPeriod,
+                sleepingRefreshSlack, RefreshTimer, NULL);
+        } else {
+            TimerQueueSchedule(&timerQueue, ETimer_Refresh, refreshPeriod, refreshPeriod, refreshSlack,
+                RefreshTimer, NULL);
+        }
+
+        TimerArmQueue(&timer, &timerQueue);
+    }
+}
+
+static void RefreshTimer(void* userData)
+{
+    (void)userData;
+
+    // Before the new minutes are stamped
+    FollowLocalTime();
+    CalculateStats();
+
+    if (window) {
+        Refresh();
+    } else {
+        UpdateIconTitle(FALSE);
+    }
+
+    if (!TimerQueueIsScheduled(&timerQueue, ETimer_Reminder)) {
+        ScheduleReminder();
+    }
+}
+
+static void JournalFlushTimer(void* userData)
+{
+    (void)userData;
+
+    FlushRecording();
+}
+
+static void StartTimers(void)
+{
+    TimerQueueInit(&timerQueue, MonotonicClock());
+
+    TimerQueueSchedule(&timerQueue, ETimer_Refresh, refreshPeriod, refreshPeriod, refreshSlack,
+        RefreshTimer, NULL);
+
+    if (config.recordPath) {
+        TimerQueueSchedule(&timerQueue, ETimer_JournalFlush, journalFlushPeriod, journalFlushPeriod,
+            journalFlushSlack, JournalFlushTimer, NULL);
+    }
+
+    ReminderInit(&reminder, &config.reminder);
+    StatsAddObserver(ReminderOnTick, &reminder);
+    ScheduleReminder();
+
+    ScheduleMidnight();
+
+    if (config.historyPath) {
+        TimerQueueSchedule(&timerQueue, ETimer_Compaction, compactionBacklogDelay, 0, compactionSlack,
+            CompactionTimer, NULL);
+    }
+
+    if (config.metricsPath) {
+        const uint64 metricsPeriod = (uint64)config.metricsInterval * 1000000;
+
+        TimerQueueSchedule(&timerQueue, ETimer_Metrics, metricsPeriod, metricsPeriod, metricsSlack,
+            MetricsTimer, NULL);
+    }
+
+    TimerArmQueue(&timer, &timerQueue);
 }
 
 static void HandleIconify(void)
 {
     window = NULL;
+    UpdateIconTitle(TRUE);
     IIntuition->IDoMethod(objects[OID_Window], WM_ICONIFY);
 }
 
 static void HandleUniconify(void)
 {
     window = (struct Window *)IIntuition->IDoMethod(objects[OID_Window], WM_OPEN);
+
+    if (window) {
+        CalculateStats();
+        Refresh();
+    }
 }
 
 static BOOL HandleMenuPick(uint16 menuNumber)
@@ -289,6 +723,7 @@ static BOOL HandleMenuPick(uint16 menuNumber)
         //printf("menu %x, menu num %d, item num %d, userdata %d\n", menuNumber, MENUNUM(menuNumber), ITEMNUM(menuNumber), (EMenu)GTMENUITEM_USERDATA(item));
         switch (id) {
             case MID_Iconify: HandleIconify(); break;
+            case MID_Export: ExportDialog(); break;
             case MID_About: ShowAboutWindow(); break;
             case MID_Quit: return FALSE;
         }
@@ -303,11 +738,13 @@ static void HandleEvents(void)
     IIntuition->GetAttr(WINDOW_SigMask, objects[OID_Window], &signal);
 
     const uint32 timerSignal = TimerSignal(&timer);
+    const uint32 arexxSignal = ArexxSignal();
+    const uint32 inputSignal = wakeSignal != -1 ? 1UL << wakeSignal : 0;
 
     BOOL running = TRUE;
 
     while (running) {
-        uint32 wait = IExec->Wait(signal | SIGBREAKF_CTRL_C | timerSignal);
+        uint32 wait = IExec->Wait(signal | SIGBREAKF_CTRL_C | timerSignal | arexxSignal | inputSignal);
 
         if (wait & SIGBREAKF_CTRL_C) {
             puts("*** Break ***");
@@ -341,17 +778,30 @@ static void HandleEvents(void)
 
         if (wait & timerSignal) {
             TimerHandleEvents(&timer);
-            if (window) {
-                Refresh();
-            }
-            TimerStart(&timer, seconds, micros);
+            TimerQueueRun(&timerQueue, ClockNow(timerQueue.clock));
+            TimerArmQueue(&timer, &timerQueue);
         }
+
+        if (wait & arexxSignal) {
+            ArexxHandleEvents();
+        }
+
+        if (wait & inputSignal) {
+            CalculateStats();
+        }
+
+        // Anything above may have ended the sleep
+        ScheduleRefresh();
     }
 }
 
 void RunGui()
 {
     OpenClasses();
+    NotifyInit();
+    ArexxInit();
+
+    wakeSignal = IExec->AllocSignal(-1);
 
 	port = IExec->AllocSysObjectTags(ASOT_PORT,
 		ASOPORT_Name, "app_port",
@@ -361,7 +811,7 @@ void RunGui()
 
     if (objects[OID_Window]) {
         if ((window = (struct Window *)IIntuition->IDoMethod(objects[OID_Window], WM_OPEN))) {
-            TimerStart(&timer, seconds, micros);
+            StartTimers();
             HandleEvents();
         } else {
             puts("Failed to open window");
@@ -369,6 +819,8 @@ void RunGui()
 
         TimerStop(&timer);
 
+        Log("Timer queue: %zu wakeups, %zu timers fired", timerQueue.wakeups, timerQueue.fired);
+
         IIntuition->DisposeObject(objects[OID_Window]);
     } else {
         puts("Failed to create window");
@@ -378,5 +830,13 @@ void RunGui()
         IExec->FreeSysObject(ASOT_PORT, port);
     }
 
+    if (wakeSignal != -1) {
+        // Disarms the input handler before the signal goes
+        CalculateStats();
+        IExec->FreeSignal(wakeSignal);
+    }
+
+    ArexxQuit();
+    NotifyQuit();
     CloseClasses();
 }
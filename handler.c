@@ -0,0 +1,274 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "handler.h"
+#include "collectors.h"
+#include "journal.h"
+
+#ifdef __amigaos4__
+#include <proto/exec.h>
+#endif
+
+// Integer square root, rounded down like the truncated sqrt() it replaces
+static inline uint32 ISqrt(uint32 n)
+{
+    uint32 root = 0;
+    uint32 bit = 1UL << 30;
+
+    while (bit > n) {
+        bit >>= 2;
+    }
+
+    while (bit) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+const char* const pointerSourceNames[EPointerSource_Count] = { "position", "pixel", "tablet", "newtablet" };
+
+static inline uint64 EventTime(const struct InputEvent* e)
+{
+    return (uint64)e->ie_TimeStamp.Seconds * 1000000 + e->ie_TimeStamp.Microseconds;
+}
+
+#if COLLECT_POINTERS
+
+// Positions may jump across the whole 16 bit range, where the sum of
+// squares would overflow. Such a jump counts as its longer side.
+static uint32 Distance(int dx, int dy)
+{
+    const uint32 ax = dx < 0 ? -dx : dx;
+    const uint32 ay = dy < 0 ? -dy : dy;
+
+    if (ax > 46340 || ay > 46340) {
+        return ax > ay ? ax : ay;
+    }
+
+    return ISqrt(ax * ax + ay * ay);
+}
+
+static int16 Scale(uint32 value, uint32 range, uint16 size)
+{
+    if (!range || !size) {
+        return (int16)value;
+    }
+
+    return (int16)((uint64)value * (size - 1) / range);
+}
+
+// Resolves a new style pointer position to screen pixels
+static BOOL ToPointerPos(const struct InputEvent* e, const Counter* mc, struct InputEvent* pos)
+{
+    if (!e->ie_EventAddress) {
+        return FALSE;
+    }
+
+    *pos = *e;
+    pos->ie_Class = IECLASS_POINTERPOS;
+
+    switch (e->ie_SubClass) {
+        case IESUBCLASS_PIXEL: {
+            const struct IEPointerPixel* pp = (const struct IEPointerPixel *)e->ie_EventAddress;
+            pos->ie_SubClass = EPointerSource_Pixel;
+            pos->ie_X = pp->iepp_Position.X;
+            pos->ie_Y = pp->iepp_Position.Y;
+            return TRUE;
+        }
+        case IESUBCLASS_TABLET: {
+            const struct IEPointerTablet* pt = (const struct IEPointerTablet *)e->ie_EventAddress;
+            pos->ie_SubClass = EPointerSource_Tablet;
+            pos->ie_X = Scale(pt->iept_Value.X, pt->iept_Range.X, mc->screenWidth);
+            pos->ie_Y = Scale(pt->iept_Value.Y, pt->iept_Range.Y, mc->screenHeight);
+            return TRUE;
+        }
+        case IESUBCLASS_NEWTABLET: {
+            const struct IENewTablet* nt = (const struct IENewTablet *)e->ie_EventAddress;
+            pos->ie_SubClass = EPointerSource_NewTablet;
+            pos->ie_X = Scale(nt->ient_TabletX, nt->ient_RangeX, mc->screenWidth);
+            pos->ie_Y = Scale(nt->ient_TabletY, nt->ient_RangeY, mc->screenHeight);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+#endif
+
+// Stages of the event loop. Disabled ones are empty and vanish when inlined.
+
+static inline void CollectButton(Counter* mc, uint16 code)
+{
+#if COLLECT_BUTTONS
+    switch (code) {
+        case IECODE_LBUTTON:
+            mc->left++;
+            break;
+        case IECODE_MBUTTON:
+            mc->middle++;
+            break;
+        case IECODE_RBUTTON:
+            mc->right++;
+            break;
+        case IECODE_4TH_BUTTON:
+            mc->fourth++;
+            break;
+        case IECODE_5TH_BUTTON:
+            mc->fifth++;
+            break;
+    }
+#else
+    (void)mc;
+    (void)code;
+#endif
+}
+
+static inline void CollectGesture(Counter* mc, const struct InputEvent* e, uint32 distance)
+{
+#if COLLECT_GESTURES
+    GesturesOnMove(&mc->gestures, distance);
+
+    if (e->ie_Code != IECODE_NOBUTTON) {
+        GesturesOnButton(&mc->gestures, e->ie_Code, EventTime(e));
+    }
+#else
+    (void)mc;
+    (void)e;
+    (void)distance;
+#endif
+}
+
+static inline void CollectMouse(Counter* mc, const struct InputEvent* e)
+{
+    const int x = e->ie_X;
+    const int y = e->ie_Y;
+    const uint32 distance = ISqrt((uint32)(x * x) + (uint32)(y * y));
+
+    mc->lastTime = e->ie_TimeStamp.Seconds;
+    mc->activity++;
+    mc->pixels += distance;
+
+    CollectGesture(mc, e, distance);
+    CollectButton(mc, e->ie_Code);
+}
+
+#if COLLECT_POINTERS
+static inline void CollectPointer(Counter* mc, const struct InputEvent* e)
+{
+    PointerSource* ps = &mc->pointers[e->ie_SubClass < EPointerSource_Count ? e->ie_SubClass : 0];
+    const int x = e->ie_X;
+    const int y = e->ie_Y;
+    uint32 distance = 0;
+
+    if (ps->seen) {
+        distance = Distance(x - ps->x, y - ps->y);
+        ps->pixels += distance;
+        mc->pixels += distance;
+    }
+
+    CollectGesture(mc, e, distance);
+    CollectButton(mc, e->ie_Code);
+
+    ps->x = x;
+    ps->y = y;
+    ps->seen = TRUE;
+    ps->events++;
+
+    mc->lastTime = e->ie_TimeStamp.Seconds;
+    mc->activity++;
+}
+#endif
+
+// All enabled stages run in one pass over the event list
+struct InputEvent* InputEventHandler(struct InputEvent* events, APTR data)
+{
+    if (!(events && data)) {
+        return events;
+    }
+
+    struct InputEvent* e = events;
+    Counter* mc = (Counter *)data;
+    const size_t activity = mc->activity;
+
+    mc->called++;
+
+    while (e) {
+        const struct InputEvent* event = e;
+#if COLLECT_POINTERS
+        struct InputEvent converted;
+
+        if (e->ie_Class == IECLASS_NEWPOINTERPOS && ToPointerPos(e, mc, &converted)) {
+            event = &converted;
+        }
+#endif
+
+#if COLLECT_JOURNAL
+        if (mc->ring) {
+            JournalRingPush(mc->ring, event);
+        }
+#endif
+
+        switch (event->ie_Class) {
+            case IECLASS_RAWMOUSE:
+                CollectMouse(mc, event);
+                break;
+#if COLLECT_POINTERS
+            case IECLASS_POINTERPOS:
+                CollectPointer(mc, event);
+                break;
+#endif
+            case IECLASS_RAWKEY:
+                if (!(event->ie_Code & IECODE_UP_PREFIX)) {
+                    mc->lastTime = event->ie_TimeStamp.Seconds;
+                    mc->activity++;
+                    mc->keys++;
+                }
+                break;
+        }
+
+        e = e->ie_NextEvent;
+    }
+
+    const uint32 wakeSignal = mc->wakeSignal;
+
+    if (wakeSignal && mc->activity != activity) {
+#ifdef __amigaos4__
+        IExec->Signal((struct Task *)mc->wakeTask, wakeSignal);
+#endif
+        mc->wakeSignal = 0;
+    }
+
+    return events;
+}
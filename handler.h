@@ -0,0 +1,79 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "input.h"
+#include "gesture.h"
+
+#include <stddef.h>
+
+struct JournalRing;
+
+// Absolute pointer positions by origin. Positions from IECLASS_NEWPOINTERPOS
+// events are converted to IECLASS_POINTERPOS screen positions with the
+// source as the subclass, so a plain IECLASS_POINTERPOS is the first one.
+typedef enum EPointerSource {
+    EPointerSource_Position,
+    EPointerSource_Pixel,
+    EPointerSource_Tablet,
+    EPointerSource_NewTablet,
+    EPointerSource_Count // KEEP LAST
+} EPointerSource;
+
+typedef struct PointerSource
+{
+    size_t events;
+    size_t pixels;
+    int16 x;
+    int16 y;
+    BOOL seen;
+} PointerSource;
+
+typedef struct Counter
+{
+    size_t left;
+    size_t middle;
+    size_t right;
+    size_t fourth;
+    size_t fifth;
+    size_t pixels;
+    size_t called;
+    size_t lastTime;
+    size_t keys;
+    size_t activity;
+    struct JournalRing* ring;
+    void* volatile wakeTask; // Stored before wakeSignal
+    volatile uint32 wakeSignal; // Sent on the next input, then cleared
+    uint16 screenWidth; // Tablet coordinates are scaled to this
+    uint16 screenHeight;
+    PointerSource pointers[EPointerSource_Count];
+    Gestures gestures;
+} Counter;
+
+extern const char* const pointerSourceNames[EPointerSource_Count];
+
+struct InputEvent* InputEventHandler(struct InputEvent* events, APTR data);
@@ -0,0 +1,154 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Times InputEventHandler per event for the collectors it was built with.
+// `make benchmatrix` builds and runs it for each configuration.
+
+#include "handler.h"
+#include "collectors.h"
+#include "journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_EVENTS 4096
+#define BENCH_MAX_LIST 8
+
+static struct InputEvent events[BENCH_EVENTS];
+static struct InputEvent* lists[BENCH_EVENTS];
+static size_t listCount;
+
+static struct IENewTablet tablet = { NULL, 0, 0, 0, 0, 0, 0, 100000, 80000, NULL };
+
+static double Elapsed(const struct timespec* since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+// Mostly relative mouse movement with some keys, clicks, tablet positions
+// and timer ticks, delivered in lists of up to 8 events
+static void GenerateEvents()
+{
+    uint64 time = 1000000000ULL;
+    BOOL pressed = FALSE;
+
+    srand(1);
+
+    for (size_t i = 0; i < BENCH_EVENTS; i++) {
+        struct InputEvent* e = &events[i];
+        const int kind = rand() % 100;
+
+        time += rand() % 2000;
+        e->ie_TimeStamp.Seconds = time / 1000000;
+        e->ie_TimeStamp.Microseconds = time % 1000000;
+        e->ie_Code = IECODE_NOBUTTON;
+
+        if (kind < 60) {
+            e->ie_Class = IECLASS_RAWMOUSE;
+            e->ie_X = rand() % 21 - 10;
+            e->ie_Y = rand() % 21 - 10;
+        } else if (kind < 65) {
+            e->ie_Class = IECLASS_RAWMOUSE;
+            e->ie_Code = pressed ? IECODE_LBUTTON | IECODE_UP_PREFIX : IECODE_LBUTTON;
+            pressed = !pressed;
+        } else if (kind < 85) {
+            e->ie_Class = IECLASS_RAWKEY;
+            e->ie_Code = (rand() % 0x60) | (rand() % 2 ? IECODE_UP_PREFIX : 0);
+        } else if (kind < 95) {
+            e->ie_Class = IECLASS_NEWPOINTERPOS;
+            e->ie_SubClass = IESUBCLASS_NEWTABLET;
+            e->ie_EventAddress = &tablet;
+        } else {
+            e->ie_Class = IECLASS_TIMER;
+        }
+    }
+
+    for (size_t i = 0; i < BENCH_EVENTS; ) {
+        const size_t length = 1 + rand() % BENCH_MAX_LIST;
+        const size_t end = i + length < BENCH_EVENTS ? i + length : BENCH_EVENTS;
+
+        lists[listCount++] = &events[i];
+
+        for (size_t j = i; j + 1 < end; j++) {
+            events[j].ie_NextEvent = &events[j + 1];
+        }
+
+        i = end;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    static Counter counter;
+    static JournalRing ring;
+
+    const uint32 rounds = argc > 1 ? atoi(argv[1]) : 5000;
+    double best = 0;
+
+    GenerateEvents();
+
+    counter.screenWidth = 1920;
+    counter.screenHeight = 1080;
+    counter.ring = &ring;
+
+    for (int pass = 0; pass < 3; pass++) {
+        struct timespec started;
+
+        clock_gettime(CLOCK_MONOTONIC, &started);
+
+        for (uint32 r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < listCount; i++) {
+                // The tablet moves every round so each position counts
+                tablet.ient_TabletX = (r * 37 + i) % 100001;
+                tablet.ient_TabletY = (r * 53 + i) % 80001;
+
+                InputEventHandler(lists[i], &counter);
+
+                // Stands in for the consumer draining the ring
+                ring.tail = ring.head;
+            }
+        }
+
+        const double elapsed = Elapsed(&started);
+
+        if (pass == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    const double total = (double)rounds * BENCH_EVENTS;
+
+    printf("buttons=%d pointers=%d gestures=%d journal=%d: %6.2f ns/event (%zu activity, %zu pixels, %zu clicks)\n",
+        COLLECT_BUTTONS, COLLECT_POINTERS, COLLECT_GESTURES, COLLECT_JOURNAL,
+        best * 1e9 / total, counter.activity / 3, counter.pixels / 3, counter.gestures.clicks / 3);
+
+    return 0;
+}
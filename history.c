@@ -0,0 +1,834 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "history.h"
+#include "varint.h"
+#include "files.h"
+
+#include <string.h>
+
+// Log: magic, number of records already compacted, then fixed width records
+// Block: magic, first minute, record count, byte size of every column, then
+// the columns. Column 0 holds the minutes, column 1 + n metric n.
+//
+// Columns are zigzag deltas against the previous value. A zero delta is
+// followed by a run length, so idle and repeating columns cost a few bytes
+// per block.
+
+static const char logMagic[4] = { 'A', 'M', 'L', '1' };
+static const char blockMagic[4] = { 'A', 'M', 'B', '1' };
+
+#define LOG_HEADER_SIZE 8
+#define INDEX_ENTRY_SIZE 20
+#define REWRITE_LOG_AFTER (4 * HISTORY_BLOCK_RECORDS)
+#define HISTORY_READ_BUFFER 65536
+
+History history;
+
+static uint32 ColumnValue(const MinuteRecord* record, int column)
+{
+    return column == 0 ? record->minute : record->values[column - 1];
+}
+
+static void SetColumnValue(MinuteRecord* record, int column, uint32 value)
+{
+    if (column == 0) {
+        record->minute = value;
+    } else {
+        record->values[column - 1] = value;
+    }
+}
+
+static void PutRecord(uint8* dst, const MinuteRecord* record)
+{
+    for (int c = 0; c < HISTORY_COLUMNS; c++) {
+        PutBE32(dst + 4 * c, ColumnValue(record, c));
+    }
+}
+
+static void GetRecord(const uint8* src, MinuteRecord* record)
+{
+    for (int c = 0; c < HISTORY_COLUMNS; c++) {
+        SetColumnValue(record, c, GetBE32(src + 4 * c));
+    }
+}
+
+static size_t EncodeColumn(const MinuteRecord* records, size_t count, int column, uint8* dst)
+{
+    uint32 previous = column == 0 ? records[0].minute : 0;
+    size_t len = 0;
+    size_t i = 0;
+
+    while (i < count) {
+        const uint32 value = ColumnValue(&records[i], column);
+
+        if (value == previous) {
+            size_t run = 1;
+
+            while (i + run < count && ColumnValue(&records[i + run], column) == value) {
+                run++;
+            }
+
+            dst[len++] = 0;
+            len += VarintPut(dst + len, run - 1);
+            i += run;
+        } else {
+            len += VarintPut(dst + len, ZigZagEncode((int64)value - previous));
+            previous = value;
+            i++;
+        }
+    }
+
+    return len;
+}
+
+static BOOL DecodeColumn(const uint8* src, size_t size, uint32 first, int column, MinuteRecord* records, size_t count)
+{
+    const uint8* end = src + size;
+    uint32 previous = column == 0 ? first : 0;
+    size_t i = 0;
+
+    while (i < count) {
+        uint64 token;
+        size_t len = VarintGet(src, end, &token);
+
+        if (!len) {
+            return FALSE;
+        }
+
+        src += len;
+
+        if (token == 0) {
+            uint64 run;
+
+            if (!(len = VarintGet(src, end, &run)) || i + run + 1 > count) {
+                return FALSE;
+            }
+
+            src += len;
+
+            for (uint64 r = 0; r <= run; r++) {
+                SetColumnValue(&records[i++], column, previous);
+            }
+        } else {
+            previous = (uint32)(previous + ZigZagDecode(token));
+            SetColumnValue(&records[i++], column, previous);
+        }
+    }
+
+    return TRUE;
+}
+
+size_t HistoryEncodeBlock(const MinuteRecord* records, size_t count, uint8* block)
+{
+    size_t offset = HISTORY_BLOCK_HEADER_SIZE;
+
+    memcpy(block, blockMagic, sizeof(blockMagic));
+    PutBE32(block + 4, records[0].minute);
+    PutBE32(block + 8, count);
+
+    for (int c = 0; c < HISTORY_COLUMNS; c++) {
+        const size_t size = EncodeColumn(records, count, c, block + offset);
+
+        PutBE32(block + 12 + 4 * c, size);
+        offset += size;
+    }
+
+    return offset;
+}
+
+static BOOL ParseBlockHeader(const uint8* block, uint32* first, uint32* count, uint32* sizes)
+{
+    if (memcmp(block, blockMagic, sizeof(blockMagic)) != 0) {
+        return FALSE;
+    }
+
+    *first = GetBE32(block + 4);
+    *count = GetBE32(block + 8);
+
+    for (int c = 0; c < HISTORY_COLUMNS; c++) {
+        sizes[c] = GetBE32(block + 12 + 4 * c);
+    }
+
+    return *count <= HISTORY_BLOCK_RECORDS;
+}
+
+size_t HistoryDecodeBlock(const uint8* block, size_t size, MinuteRecord* records)
+{
+    uint32 first, count, sizes[HISTORY_COLUMNS];
+
+    if (size < HISTORY_BLOCK_HEADER_SIZE || !ParseBlockHeader(block, &first, &count, sizes)) {
+        return 0;
+    }
+
+    size_t offset = HISTORY_BLOCK_HEADER_SIZE;
+
+    for (int c = 0; c < HISTORY_COLUMNS; c++) {
+        if (offset + sizes[c] > size || !DecodeColumn(block + offset, sizes[c], first, c, records, count)) {
+            return 0;
+        }
+
+        offset += sizes[c];
+    }
+
+    return count;
+}
+
+static void PutIndexEntry(uint8* dst, const HistoryIndexEntry* entry)
+{
+    PutBE32(dst, entry->firstMinute);
+    PutBE32(dst + 4, entry->lastMinute);
+    PutBE32(dst + 8, entry->offset);
+    PutBE32(dst + 12, entry->size);
+    PutBE32(dst + 16, entry->count);
+}
+
+static BOOL ReadIndexEntry(FILE* index, size_t n, HistoryIndexEntry* entry)
+{
+    uint8 buf[INDEX_ENTRY_SIZE];
+
+    if (fseek(index, (long)(n * INDEX_ENTRY_SIZE), SEEK_SET) != 0 || fread(buf, 1, sizeof(buf), index) != sizeof(buf)) {
+        return FALSE;
+    }
+
+    entry->firstMinute = GetBE32(buf);
+    entry->lastMinute = GetBE32(buf + 4);
+    entry->offset = GetBE32(buf + 8);
+    entry->size = GetBE32(buf + 12);
+    entry->count = GetBE32(buf + 16);
+
+    return TRUE;
+}
+
+static size_t FileSize(FILE* file)
+{
+    if (!file || fseek(file, 0, SEEK_END) != 0) {
+        return 0;
+    }
+
+    const long size = ftell(file);
+
+    return size > 0 ? (size_t)size : 0;
+}
+
+static BOOL ReadLogHeader(FILE* log, uint32* compacted, size_t* total)
+{
+    uint8 header[LOG_HEADER_SIZE];
+    const size_t size = FileSize(log);
+
+    if (size < LOG_HEADER_SIZE || fseek(log, 0, SEEK_SET) != 0 || fread(header, 1, sizeof(header), log) != sizeof(header)) {
+        return FALSE;
+    }
+
+    if (memcmp(header, logMagic, sizeof(logMagic)) != 0) {
+        return FALSE;
+    }
+
+    *compacted = GetBE32(header + 4);
+    *total = (size - LOG_HEADER_SIZE) / HISTORY_RECORD_SIZE;
+
+    return *compacted <= *total;
+}
+
+static BOOL WriteLogHeader(FILE* log, uint32 compacted)
+{
+    uint8 header[LOG_HEADER_SIZE];
+
+    memcpy(header, logMagic, sizeof(logMagic));
+    PutBE32(header + 4, compacted);
+
+    return fseek(log, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), log) == sizeof(header);
+}
+
+static void MakePath(char* path, const char* const basePath, const char* const suffix)
+{
+    snprintf(path, HISTORY_PATH_LENGTH, "%s%s", basePath, suffix);
+}
+
+static uint32 LastCompactedMinute(History* h, BOOL* found)
+{
+    HistoryIndexEntry entry;
+    FILE* index = fopen(h->indexPath, "rb");
+
+    *found = FALSE;
+
+    if (index) {
+        const size_t entries = FileSize(index) / INDEX_ENTRY_SIZE;
+
+        if (entries && ReadIndexEntry(index, entries - 1, &entry)) {
+            *found = TRUE;
+        }
+
+        fclose(index);
+    }
+
+    return *found ? entry.lastMinute : 0;
+}
+
+// The last minute written, from the end of the log or the block index
+static void FindLastMinute(History* h)
+{
+    uint32 compacted;
+    size_t total;
+    FILE* log = fopen(h->logPath, "rb");
+
+    if (log && ReadLogHeader(log, &compacted, &total) && total > 0) {
+        uint8 buf[HISTORY_RECORD_SIZE];
+        MinuteRecord record;
+
+        if (fseek(log, LOG_HEADER_SIZE + (total - 1) * HISTORY_RECORD_SIZE, SEEK_SET) == 0 &&
+            fread(buf, 1, sizeof(buf), log) == sizeof(buf)) {
+            GetRecord(buf, &record);
+            h->lastMinute = record.minute;
+            h->hasLastMinute = TRUE;
+        }
+    }
+
+    if (log) {
+        fclose(log);
+    }
+
+    if (!h->hasLastMinute) {
+        h->lastMinute = LastCompactedMinute(h, &h->hasLastMinute);
+    }
+}
+
+BOOL HistoryInit(History* h, const char* const basePath)
+{
+    memset(h, 0, sizeof(*h));
+
+    MakePath(h->logPath, basePath, ".log");
+    MakePath(h->dataPath, basePath, ".amh");
+    MakePath(h->indexPath, basePath, ".idx");
+
+    char tempPath[HISTORY_PATH_LENGTH];
+    MakePath(tempPath, basePath, ".log.tmp");
+
+    FILE* log = fopen(h->logPath, "rb");
+
+    if (log) {
+        fclose(log);
+    } else if (rename(tempPath, h->logPath) == 0) {
+        // Interrupted log rewrite
+        printf("Recovered history log from '%s'\n", tempPath);
+    } else {
+        log = fopen(h->logPath, "wb");
+
+        if (!log || !WriteLogHeader(log, 0)) {
+            printf("Failed to create history log '%s'\n", h->logPath);
+
+            if (log) {
+                fclose(log);
+            }
+
+            return FALSE;
+        }
+
+        fclose(log);
+    }
+
+    FindLastMinute(h);
+
+    return TRUE;
+}
+
+// Adds the record into the last one in the log, unless that has already
+// been compacted
+static BOOL CombineWithLast(History* h, const MinuteRecord* record)
+{
+    uint32 compacted;
+    size_t total;
+    BOOL ok = FALSE;
+    FILE* log = fopen(h->logPath, "r+b");
+
+    if (!log) {
+        return FALSE;
+    }
+
+    if (ReadLogHeader(log, &compacted, &total) && total > compacted) {
+        const long offset = (long)(LOG_HEADER_SIZE + (total - 1) * HISTORY_RECORD_SIZE);
+        uint8 buf[HISTORY_RECORD_SIZE];
+        MinuteRecord last;
+
+        if (fseek(log, offset, SEEK_SET) == 0 && fread(buf, 1, sizeof(buf), log) == sizeof(buf)) {
+            GetRecord(buf, &last);
+
+            if (last.minute == h->lastMinute) {
+                for (int i = 0; i < EMetric_Count; i++) {
+                    last.values[i] += record->values[i];
+                }
+
+                PutRecord(buf, &last);
+                ok = fseek(log, offset, SEEK_SET) == 0 && fwrite(buf, 1, sizeof(buf), log) == sizeof(buf);
+            }
+        }
+    }
+
+    fclose(log);
+
+    return ok;
+}
+
+void HistoryOnMinute(const MinuteRecord* record, void* userData)
+{
+    History* h = (History *)userData;
+    uint8 buf[HISTORY_RECORD_SIZE];
+
+    if (h->hasLastMinute && record->minute <= h->lastMinute) {
+        if (CombineWithLast(h, record)) {
+            h->combined++;
+        } else {
+            h->dropped++;
+        }
+
+        return;
+    }
+
+    PutRecord(buf, record);
+
+    FILE* log = fopen(h->logPath, "ab");
+
+    if (log) {
+        if (fwrite(buf, 1, sizeof(buf), log) == sizeof(buf)) {
+            h->appended++;
+            h->lastMinute = record->minute;
+            h->hasLastMinute = TRUE;
+        }
+
+        fclose(log);
+    }
+}
+
+static BOOL AppendBlock(History* h, size_t count)
+{
+    HistoryIndexEntry entry;
+
+    const size_t size = HistoryEncodeBlock(h->records, count, h->block);
+
+    FILE* data = fopen(h->dataPath, "ab");
+
+    if (!data) {
+        printf("Failed to open history data '%s'\n", h->dataPath);
+        return FALSE;
+    }
+
+    entry.firstMinute = h->records[0].minute;
+    entry.lastMinute = h->records[count - 1].minute;
+    entry.offset = FileSize(data);
+    entry.size = size;
+    entry.count = count;
+
+    const BOOL written = fwrite(h->block, 1, size, data) == size;
+
+    fclose(data);
+
+    if (!written) {
+        return FALSE;
+    }
+
+    uint8 buf[INDEX_ENTRY_SIZE];
+    PutIndexEntry(buf, &entry);
+
+    FILE* index = fopen(h->indexPath, "ab");
+
+    if (!index) {
+        return FALSE;
+    }
+
+    const BOOL indexed = fwrite(buf, 1, sizeof(buf), index) == sizeof(buf);
+
+    fclose(index);
+
+    h->compactedBlocks++;
+    h->rawBytes += count * HISTORY_RECORD_SIZE;
+    h->compactedBytes += size;
+
+    return indexed;
+}
+
+// Drops the compacted records from the front of the log
+static void RewriteLog(History* h, FILE* log, uint32 compacted, size_t total)
+{
+    char tempPath[HISTORY_PATH_LENGTH + 4];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", h->logPath);
+
+    FILE* temp = fopen(tempPath, "wb");
+
+    if (!temp) {
+        return;
+    }
+
+    BOOL ok = WriteLogHeader(temp, 0) && fseek(log, LOG_HEADER_SIZE + compacted * HISTORY_RECORD_SIZE, SEEK_SET) == 0;
+
+    for (size_t left = (total - compacted) * HISTORY_RECORD_SIZE; ok && left > 0; ) {
+        const size_t chunk = left < sizeof(h->block) ? left : sizeof(h->block);
+
+        ok = fread(h->block, 1, chunk, log) == chunk && fwrite(h->block, 1, chunk, temp) == chunk;
+        left -= chunk;
+    }
+
+    fclose(temp);
+    fclose(log);
+
+    if (!ok) {
+        remove(tempPath);
+    } else if (!ReplaceFile(tempPath, h->logPath)) {
+        printf("Failed to replace history log '%s' with '%s'\n", h->logPath, tempPath);
+    }
+}
+
+// Compacts at most one block per call so that the caller can spread the
+// work. Returns TRUE if another full block is waiting.
+BOOL HistoryCompact(History* h)
+{
+    uint32 compacted;
+    size_t total;
+
+    FILE* log = fopen(h->logPath, "r+b");
+
+    if (!log) {
+        return FALSE;
+    }
+
+    if (!ReadLogHeader(log, &compacted, &total) || total - compacted < HISTORY_BLOCK_RECORDS) {
+        fclose(log);
+        return FALSE;
+    }
+
+    uint8* raw = h->block;
+
+    if (fseek(log, LOG_HEADER_SIZE + compacted * HISTORY_RECORD_SIZE, SEEK_SET) != 0 ||
+        fread(raw, HISTORY_RECORD_SIZE, HISTORY_BLOCK_RECORDS, log) != HISTORY_BLOCK_RECORDS) {
+        fclose(log);
+        return FALSE;
+    }
+
+    // Records already in a block, if the header update was lost last time
+    BOOL found;
+    const uint32 lastMinute = LastCompactedMinute(h, &found);
+    size_t count = 0;
+
+    for (size_t i = 0; i < HISTORY_BLOCK_RECORDS; i++) {
+        GetRecord(raw + i * HISTORY_RECORD_SIZE, &h->records[count]);
+
+        if (!found || h->records[count].minute > lastMinute) {
+            count++;
+        }
+    }
+
+    if (count && !AppendBlock(h, count)) {
+        fclose(log);
+        return FALSE;
+    }
+
+    compacted += HISTORY_BLOCK_RECORDS;
+
+    if (!WriteLogHeader(log, compacted)) {
+        fclose(log);
+        return FALSE;
+    }
+
+    if (compacted >= REWRITE_LOG_AFTER) {
+        RewriteLog(h, log, compacted, total);
+    } else {
+        fclose(log);
+    }
+
+    return total - compacted >= HISTORY_BLOCK_RECORDS;
+}
+
+// Bulk writing for tools. Records must be in time order. Full blocks go
+// straight to the columnar file, the rest to the log.
+BOOL HistoryCreate(History* h, const char* const basePath)
+{
+    char path[HISTORY_PATH_LENGTH];
+    static const char* const suffixes[] = { ".log", ".amh", ".idx", ".log.tmp" };
+
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        MakePath(path, basePath, suffixes[i]);
+        remove(path);
+    }
+
+    return HistoryInit(h, basePath);
+}
+
+BOOL HistoryWrite(History* h, const MinuteRecord* record)
+{
+    h->records[h->buffered++] = *record;
+
+    if (h->buffered < HISTORY_BLOCK_RECORDS) {
+        return TRUE;
+    }
+
+    h->buffered = 0;
+
+    return AppendBlock(h, HISTORY_BLOCK_RECORDS);
+}
+
+BOOL HistoryWriteFinish(History* h)
+{
+    FILE* log = fopen(h->logPath, "ab");
+
+    if (!log) {
+        return FALSE;
+    }
+
+    BOOL ok = TRUE;
+
+    for (size_t i = 0; ok && i < h->buffered; i++) {
+        uint8 buf[HISTORY_RECORD_SIZE];
+
+        PutRecord(buf, &h->records[i]);
+        ok = fwrite(buf, 1, sizeof(buf), log) == sizeof(buf);
+    }
+
+    fclose(log);
+
+    h->appended += h->buffered;
+    h->buffered = 0;
+
+    return ok;
+}
+
+BOOL HistoryReaderOpen(HistoryReader* hr, const char* const basePath)
+{
+    char path[HISTORY_PATH_LENGTH];
+
+    memset(hr, 0, sizeof(*hr));
+
+    MakePath(path, basePath, ".amh");
+    hr->data = fopen(path, "rb");
+
+    MakePath(path, basePath, ".idx");
+    hr->index = fopen(path, "rb");
+
+    MakePath(path, basePath, ".log");
+    hr->log = fopen(path, "rb");
+
+    if (hr->log) {
+        setvbuf(hr->log, NULL, _IOFBF, HISTORY_READ_BUFFER);
+    }
+
+    if (!hr->log && !(hr->data && hr->index)) {
+        HistoryReaderClose(hr);
+        return FALSE;
+    }
+
+    if (hr->data && hr->index) {
+        HistoryIndexEntry entry;
+
+        hr->blocks = FileSize(hr->index) / INDEX_ENTRY_SIZE;
+
+        if (hr->blocks && ReadIndexEntry(hr->index, hr->blocks - 1, &entry)) {
+            hr->lastBlockMinute = entry.lastMinute;
+        }
+    }
+
+    HistoryReaderSeek(hr, 0);
+
+    return TRUE;
+}
+
+void HistoryReaderClose(HistoryReader* hr)
+{
+    if (hr->data) {
+        fclose(hr->data);
+    }
+
+    if (hr->index) {
+        fclose(hr->index);
+    }
+
+    if (hr->log) {
+        fclose(hr->log);
+    }
+
+    hr->data = hr->index = hr->log = NULL;
+}
+
+static size_t FindBlock(HistoryReader* hr, uint32 minute)
+{
+    HistoryIndexEntry entry;
+    size_t low = 0;
+    size_t high = hr->blocks;
+
+    while (low < high) {
+        const size_t mid = (low + high) / 2;
+
+        if (!ReadIndexEntry(hr->index, mid, &entry)) {
+            return hr->blocks;
+        }
+
+        if (entry.lastMinute >= minute) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    return low;
+}
+
+static void SeekLog(HistoryReader* hr)
+{
+    uint32 compacted;
+    size_t total;
+
+    if (hr->log && ReadLogHeader(hr->log, &compacted, &total)) {
+        fseek(hr->log, LOG_HEADER_SIZE + compacted * HISTORY_RECORD_SIZE, SEEK_SET);
+    } else if (hr->log) {
+        fclose(hr->log);
+        hr->log = NULL;
+    }
+}
+
+void HistoryReaderSeek(HistoryReader* hr, uint32 fromMinute)
+{
+    hr->from = fromMinute;
+    hr->position = 0;
+    hr->count = 0;
+    hr->nextBlock = hr->blocks ? FindBlock(hr, fromMinute) : 0;
+
+    SeekLog(hr);
+}
+
+static BOOL ReadBlockBytes(HistoryReader* hr, uint32 offset, size_t size)
+{
+    return size <= sizeof(hr->block) && fseek(hr->data, offset, SEEK_SET) == 0 &&
+        fread(hr->block, 1, size, hr->data) == size;
+}
+
+static BOOL LoadBlock(HistoryReader* hr, size_t n)
+{
+    HistoryIndexEntry entry;
+
+    hr->position = 0;
+    hr->count = 0;
+
+    if (!ReadIndexEntry(hr->index, n, &entry) || !ReadBlockBytes(hr, entry.offset, entry.size)) {
+        return FALSE;
+    }
+
+    hr->count = HistoryDecodeBlock(hr->block, entry.size, hr->records);
+
+    return hr->count > 0;
+}
+
+static BOOL NextLogRecord(HistoryReader* hr, MinuteRecord* record)
+{
+    uint8 buf[HISTORY_RECORD_SIZE];
+
+    while (hr->log && fread(buf, 1, sizeof(buf), hr->log) == sizeof(buf)) {
+        GetRecord(buf, record);
+
+        if ((!hr->blocks || record->minute > hr->lastBlockMinute) && record->minute >= hr->from) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+BOOL HistoryReaderNext(HistoryReader* hr, MinuteRecord* record)
+{
+    while (TRUE) {
+        while (hr->position < hr->count) {
+            *record = hr->records[hr->position++];
+
+            if (record->minute >= hr->from) {
+                return TRUE;
+            }
+        }
+
+        if (hr->nextBlock >= hr->blocks) {
+            return NextLogRecord(hr, record);
+        }
+
+        if (!LoadBlock(hr, hr->nextBlock++)) {
+            hr->damaged++;
+        }
+    }
+}
+
+// Reads only the minute column and the wanted metric's column of the
+// blocks overlapping [from, to)
+size_t HistoryReaderMetric(HistoryReader* hr, EMetric metric, uint32 from, uint32 to,
+    HistoryMetricCallback callback, void* userData)
+{
+    const int column = metric + 1;
+    size_t values = 0;
+
+    for (size_t n = hr->blocks ? FindBlock(hr, from) : 0; n < hr->blocks; n++) {
+        HistoryIndexEntry entry;
+        uint32 first, count, sizes[HISTORY_COLUMNS];
+
+        if (!ReadIndexEntry(hr->index, n, &entry) || entry.firstMinute >= to) {
+            break;
+        }
+
+        if (!ReadBlockBytes(hr, entry.offset, HISTORY_BLOCK_HEADER_SIZE) ||
+            !ParseBlockHeader(hr->block, &first, &count, sizes)) {
+            continue;
+        }
+
+        uint32 columnOffset = entry.offset + HISTORY_BLOCK_HEADER_SIZE;
+
+        for (int c = 0; c < column; c++) {
+            columnOffset += sizes[c];
+        }
+
+        if (!ReadBlockBytes(hr, entry.offset + HISTORY_BLOCK_HEADER_SIZE, sizes[0]) ||
+            !DecodeColumn(hr->block, sizes[0], first, 0, hr->records, count) ||
+            !ReadBlockBytes(hr, columnOffset, sizes[column]) ||
+            !DecodeColumn(hr->block, sizes[column], first, column, hr->records, count)) {
+            continue;
+        }
+
+        for (uint32 i = 0; i < count; i++) {
+            const MinuteRecord* record = &hr->records[i];
+
+            if (record->minute >= from && record->minute < to) {
+                callback(record->minute, record->values[metric], userData);
+                values++;
+            }
+        }
+    }
+
+    MinuteRecord record;
+    const uint32 oldFrom = hr->from;
+
+    hr->from = from;
+    SeekLog(hr);
+
+    while (NextLogRecord(hr, &record) && record.minute < to) {
+        callback(record.minute, record.values[metric], userData);
+        values++;
+    }
+
+    hr->from = oldFrom;
+
+    return values;
+}
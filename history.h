@@ -0,0 +1,115 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "minutes.h"
+
+#include <stdio.h>
+
+// Long-term history of minute records. For a base path P:
+//
+// P.log - raw minute records as the meter produces them, fixed width
+// P.amh - compacted blocks, one delta/varint encoded column per metric
+// P.idx - one fixed width entry per block, ordered by time
+//
+// The meter only appends to the log. Compaction moves full blocks from the
+// log into the columnar file in the background. Minutes stay in order across
+// restarts: a minute at or before the last one written, after the clock was
+// set back, is added into the last record while it's still in the log and
+// dropped once it has been compacted.
+
+#define HISTORY_BLOCK_RECORDS 1440
+#define HISTORY_COLUMNS (EMetric_Count + 1)
+#define HISTORY_RECORD_SIZE (4 * HISTORY_COLUMNS)
+#define HISTORY_BLOCK_HEADER_SIZE (4 + 4 + 4 + 4 * HISTORY_COLUMNS)
+#define HISTORY_MAX_BLOCK_SIZE (HISTORY_BLOCK_HEADER_SIZE + HISTORY_BLOCK_RECORDS * HISTORY_COLUMNS * 10)
+#define HISTORY_PATH_LENGTH 256
+
+typedef struct HistoryIndexEntry
+{
+    uint32 firstMinute;
+    uint32 lastMinute;
+    uint32 offset;
+    uint32 size;
+    uint32 count;
+} HistoryIndexEntry;
+
+typedef struct History
+{
+    char logPath[HISTORY_PATH_LENGTH];
+    char dataPath[HISTORY_PATH_LENGTH];
+    char indexPath[HISTORY_PATH_LENGTH];
+    size_t appended;
+    size_t compactedBlocks;
+    size_t rawBytes;
+    size_t compactedBytes;
+    size_t buffered;
+    size_t combined;
+    size_t dropped;
+    BOOL hasLastMinute;
+    uint32 lastMinute;
+    MinuteRecord records[HISTORY_BLOCK_RECORDS];
+    uint8 block[HISTORY_MAX_BLOCK_SIZE];
+} History;
+
+typedef void (*HistoryMetricCallback)(uint32 minute, uint32 value, void* userData);
+
+typedef struct HistoryReader
+{
+    FILE* data;
+    FILE* index;
+    FILE* log;
+    size_t blocks;
+    size_t nextBlock;
+    uint32 lastBlockMinute;
+    uint32 from;
+    size_t position;
+    size_t count;
+    size_t damaged;
+    MinuteRecord records[HISTORY_BLOCK_RECORDS];
+    uint8 block[HISTORY_MAX_BLOCK_SIZE];
+} HistoryReader;
+
+extern History history;
+
+BOOL HistoryInit(History* h, const char* const basePath);
+void HistoryOnMinute(const MinuteRecord* record, void* userData);
+BOOL HistoryCompact(History* h);
+
+BOOL HistoryCreate(History* h, const char* const basePath);
+BOOL HistoryWrite(History* h, const MinuteRecord* record);
+BOOL HistoryWriteFinish(History* h);
+
+BOOL HistoryReaderOpen(HistoryReader* hr, const char* const basePath);
+void HistoryReaderClose(HistoryReader* hr);
+void HistoryReaderSeek(HistoryReader* hr, uint32 fromMinute);
+BOOL HistoryReaderNext(HistoryReader* hr, MinuteRecord* record);
+size_t HistoryReaderMetric(HistoryReader* hr, EMetric metric, uint32 from, uint32 to,
+    HistoryMetricCallback callback, void* userData);
+
+size_t HistoryEncodeBlock(const MinuteRecord* records, size_t count, uint8* block);
+size_t HistoryDecodeBlock(const uint8* block, size_t size, MinuteRecord* records);
@@ -0,0 +1,135 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "platform.h"
+
+#ifdef __amigaos4__
+
+#include <devices/inputevent.h>
+
+#else
+
+// Subset of <devices/inputevent.h> needed by the input handler on a host
+
+struct TimeVal
+{
+    uint32 Seconds;
+    uint32 Microseconds;
+};
+
+struct InputEvent
+{
+    struct InputEvent* ie_NextEvent;
+    uint8 ie_Class;
+    uint8 ie_SubClass;
+    uint16 ie_Code;
+    uint16 ie_Qualifier;
+    union
+    {
+        struct
+        {
+            int16 ie_x;
+            int16 ie_y;
+        } ie_xy;
+        APTR ie_addr;
+    } ie_position;
+    struct TimeVal ie_TimeStamp;
+};
+
+#define ie_X ie_position.ie_xy.ie_x
+#define ie_Y ie_position.ie_xy.ie_y
+#define ie_EventAddress ie_position.ie_addr
+
+#define IECLASS_NULL 0x00
+#define IECLASS_RAWKEY 0x01
+#define IECLASS_RAWMOUSE 0x02
+#define IECLASS_POINTERPOS 0x04
+#define IECLASS_TIMER 0x06
+#define IECLASS_NEWPOINTERPOS 0x13
+
+#define IESUBCLASS_COMPATIBLE 0x00
+#define IESUBCLASS_PIXEL 0x01
+#define IESUBCLASS_TABLET 0x02
+#define IESUBCLASS_NEWTABLET 0x03
+
+#define IECODE_UP_PREFIX 0x80
+#define IECODE_LBUTTON 0x68
+#define IECODE_RBUTTON 0x69
+#define IECODE_MBUTTON 0x6A
+#define IECODE_4TH_BUTTON 0x6B
+#define IECODE_5TH_BUTTON 0x6C
+#define IECODE_NOBUTTON 0xFF
+
+#define IEQUALIFIER_REPEAT 0x0200
+
+struct Screen;
+struct Hook;
+struct TagItem;
+
+// Pointed to by ie_EventAddress of IECLASS_NEWPOINTERPOS events
+
+struct IEPointerPixel
+{
+    struct Screen* iepp_Screen;
+    struct
+    {
+        int16 X;
+        int16 Y;
+    } iepp_Position;
+};
+
+struct IEPointerTablet
+{
+    struct
+    {
+        uint16 X;
+        uint16 Y;
+    } iept_Range;
+    struct
+    {
+        uint16 X;
+        uint16 Y;
+    } iept_Value;
+    int16 iept_Pressure;
+};
+
+struct IENewTablet
+{
+    struct Hook* ient_CallBack;
+    uint16 ient_ScaledX;
+    uint16 ient_ScaledY;
+    uint16 ient_ScaledXFraction;
+    uint16 ient_ScaledYFraction;
+    uint32 ient_TabletX;
+    uint32 ient_TabletY;
+    uint32 ient_RangeX;
+    uint32 ient_RangeY;
+    struct TagItem* ient_TagList;
+};
+
+#endif
@@ -0,0 +1,362 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "journal.h"
+#include "varint.h"
+
+#include <string.h>
+
+// File layout: magic, then records. Every record starts with a tag byte
+// which is either the event class or JOURNAL_TAG_MOVES. Times are stored
+// as microsecond deltas from the previous event.
+//
+// Event: tag, dt, subclass, code, qualifier, x, y
+// Moves: tag, count, qualifier, count * (dt, x, y)
+//
+// Consecutive button-less mouse moves sharing a qualifier are coalesced into
+// one move run so only the varying parts are stored.
+
+static const char magic[4] = { 'A', 'M', 'J', '1' };
+
+#define JOURNAL_TAG_MOVES 0xFF
+#define JOURNAL_MAX_RECORD (2 + 6 * VARINT_MAX_BYTES)
+
+uint64 JournalEventTime(const JournalEvent* je)
+{
+    return (uint64)je->seconds * 1000000 + je->micros;
+}
+
+static BOOL IsMove(const JournalEvent* je)
+{
+    return je->eventClass == IECLASS_RAWMOUSE && je->code == IECODE_NOBUTTON && je->subClass == 0;
+}
+
+static void WriteBuffer(JournalWriter* jw)
+{
+    if (jw->used) {
+        if (fwrite(jw->buffer, 1, jw->used, jw->file) != jw->used) {
+            puts("Failed to write journal");
+        }
+        jw->bytes += jw->used;
+        jw->used = 0;
+    }
+}
+
+static uint8* Reserve(JournalWriter* jw, size_t size)
+{
+    if (jw->used + size > sizeof(jw->buffer)) {
+        WriteBuffer(jw);
+    }
+
+    return jw->buffer + jw->used;
+}
+
+static size_t PutDelta(JournalWriter* jw, uint8* dst, const JournalEvent* je)
+{
+    const uint64 time = JournalEventTime(je);
+    const uint64 delta = time >= jw->lastTime ? time - jw->lastTime : 0;
+
+    jw->lastTime += delta;
+
+    return VarintPut(dst, delta);
+}
+
+static void FlushRun(JournalWriter* jw)
+{
+    if (!jw->runLength) {
+        return;
+    }
+
+    uint8* dst = Reserve(jw, 1 + 2 * VARINT_MAX_BYTES);
+    size_t len = 0;
+
+    dst[len++] = JOURNAL_TAG_MOVES;
+    len += VarintPut(dst + len, jw->runLength);
+    len += VarintPut(dst + len, jw->run[0].qualifier);
+    jw->used += len;
+
+    for (uint32 i = 0; i < jw->runLength; i++) {
+        const JournalEvent* je = &jw->run[i];
+
+        dst = Reserve(jw, 3 * VARINT_MAX_BYTES);
+        len = PutDelta(jw, dst, je);
+        len += VarintPut(dst + len, ZigZagEncode(je->x));
+        len += VarintPut(dst + len, ZigZagEncode(je->y));
+        jw->used += len;
+    }
+
+    jw->runLength = 0;
+}
+
+static void PutEvent(JournalWriter* jw, const JournalEvent* je)
+{
+    uint8* dst = Reserve(jw, JOURNAL_MAX_RECORD);
+    size_t len = 0;
+
+    dst[len++] = je->eventClass;
+    len += PutDelta(jw, dst + len, je);
+    dst[len++] = je->subClass;
+    len += VarintPut(dst + len, je->code);
+    len += VarintPut(dst + len, je->qualifier);
+    len += VarintPut(dst + len, ZigZagEncode(je->x));
+    len += VarintPut(dst + len, ZigZagEncode(je->y));
+
+    jw->used += len;
+}
+
+BOOL JournalWriterOpen(JournalWriter* jw, const char* const path)
+{
+    memset(jw, 0, sizeof(*jw));
+
+    jw->file = fopen(path, "wb");
+
+    if (!jw->file) {
+        printf("Failed to open journal '%s'\n", path);
+        return FALSE;
+    }
+
+    memcpy(jw->buffer, magic, sizeof(magic));
+    jw->used = sizeof(magic);
+
+    return TRUE;
+}
+
+void JournalWriterAppend(JournalWriter* jw, const JournalEvent* je)
+{
+    jw->events++;
+
+    if (IsMove(je)) {
+        if (jw->runLength && (jw->runLength == JOURNAL_MAX_RUN || jw->run[0].qualifier != je->qualifier)) {
+            FlushRun(jw);
+        }
+
+        jw->run[jw->runLength++] = *je;
+        return;
+    }
+
+    FlushRun(jw);
+    PutEvent(jw, je);
+}
+
+size_t JournalWriterDrain(JournalWriter* jw, JournalRing* ring)
+{
+    const uint32 head = ring->head;
+    uint32 tail = ring->tail;
+    size_t count = 0;
+
+    // Slots up to 'head' are filled
+    JOURNAL_BARRIER();
+
+    while (tail != head) {
+        JournalWriterAppend(jw, &ring->events[tail & (JOURNAL_RING_SIZE - 1)]);
+        tail++;
+        count++;
+    }
+
+    JOURNAL_BARRIER();
+    ring->tail = tail;
+
+    return count;
+}
+
+void JournalWriterFlush(JournalWriter* jw)
+{
+    if (jw->file) {
+        FlushRun(jw);
+        WriteBuffer(jw);
+        fflush(jw->file);
+    }
+}
+
+void JournalWriterClose(JournalWriter* jw)
+{
+    if (jw->file) {
+        JournalWriterFlush(jw);
+        fclose(jw->file);
+        jw->file = NULL;
+    }
+}
+
+static void Refill(JournalReader* jr)
+{
+    if (jr->eof || jr->size - jr->used >= JOURNAL_MAX_RECORD) {
+        return;
+    }
+
+    const size_t left = jr->size - jr->used;
+
+    memmove(jr->buffer, jr->buffer + jr->used, left);
+
+    jr->size = left + fread(jr->buffer + left, 1, sizeof(jr->buffer) - left, jr->file);
+    jr->used = 0;
+
+    if (jr->size < sizeof(jr->buffer)) {
+        jr->eof = TRUE;
+    }
+}
+
+static BOOL Get(JournalReader* jr, uint64* value)
+{
+    const size_t len = VarintGet(jr->buffer + jr->used, jr->buffer + jr->size, value);
+
+    jr->used += len;
+
+    return len > 0;
+}
+
+static BOOL GetTime(JournalReader* jr, JournalEvent* je)
+{
+    uint64 delta;
+
+    if (!Get(jr, &delta)) {
+        return FALSE;
+    }
+
+    jr->lastTime += delta;
+
+    je->seconds = (uint32)(jr->lastTime / 1000000);
+    je->micros = (uint32)(jr->lastTime % 1000000);
+
+    return TRUE;
+}
+
+static BOOL GetXY(JournalReader* jr, JournalEvent* je)
+{
+    uint64 x, y;
+
+    if (!Get(jr, &x) || !Get(jr, &y)) {
+        return FALSE;
+    }
+
+    je->x = (int16)ZigZagDecode(x);
+    je->y = (int16)ZigZagDecode(y);
+
+    return TRUE;
+}
+
+BOOL JournalReaderOpen(JournalReader* jr, const char* const path)
+{
+    memset(jr, 0, sizeof(*jr));
+
+    jr->file = fopen(path, "rb");
+
+    if (!jr->file) {
+        printf("Failed to open journal '%s'\n", path);
+        return FALSE;
+    }
+
+    Refill(jr);
+
+    if (jr->size < sizeof(magic) || memcmp(jr->buffer, magic, sizeof(magic)) != 0) {
+        printf("'%s' is not a journal file\n", path);
+        JournalReaderClose(jr);
+        return FALSE;
+    }
+
+    jr->used = sizeof(magic);
+
+    return TRUE;
+}
+
+BOOL JournalReaderNext(JournalReader* jr, JournalEvent* je)
+{
+    if (!jr->file) {
+        return FALSE;
+    }
+
+    Refill(jr);
+
+    if (jr->runRemaining) {
+        jr->runRemaining--;
+
+        je->eventClass = IECLASS_RAWMOUSE;
+        je->subClass = 0;
+        je->code = IECODE_NOBUTTON;
+        je->qualifier = jr->runQualifier;
+
+        return GetTime(jr, je) && GetXY(jr, je);
+    }
+
+    if (jr->used >= jr->size) {
+        return FALSE;
+    }
+
+    const uint8 tag = jr->buffer[jr->used++];
+
+    if (tag == JOURNAL_TAG_MOVES) {
+        uint64 count, qualifier;
+
+        if (!Get(jr, &count) || !Get(jr, &qualifier) || count == 0) {
+            return FALSE;
+        }
+
+        jr->runRemaining = (uint32)count;
+        jr->runQualifier = (uint16)qualifier;
+
+        return JournalReaderNext(jr, je);
+    }
+
+    uint64 code, qualifier;
+
+    je->eventClass = tag;
+
+    if (!GetTime(jr, je) || jr->used >= jr->size) {
+        return FALSE;
+    }
+
+    je->subClass = jr->buffer[jr->used++];
+
+    if (!Get(jr, &code) || !Get(jr, &qualifier)) {
+        return FALSE;
+    }
+
+    je->code = (uint16)code;
+    je->qualifier = (uint16)qualifier;
+
+    return GetXY(jr, je);
+}
+
+void JournalReaderClose(JournalReader* jr)
+{
+    if (jr->file) {
+        fclose(jr->file);
+        jr->file = NULL;
+    }
+}
+
+void JournalEventToInputEvent(const JournalEvent* je, struct InputEvent* e)
+{
+    memset(e, 0, sizeof(*e));
+
+    e->ie_Class = je->eventClass;
+    e->ie_SubClass = je->subClass;
+    e->ie_Code = je->code;
+    e->ie_Qualifier = je->qualifier;
+    e->ie_X = je->x;
+    e->ie_Y = je->y;
+    e->ie_TimeStamp.Seconds = je->seconds;
+    e->ie_TimeStamp.Microseconds = je->micros;
+}
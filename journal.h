@@ -0,0 +1,126 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "input.h"
+
+#include <stdio.h>
+
+// Must be a power of two
+#define JOURNAL_RING_SIZE 8192
+#define JOURNAL_BUFFER_SIZE (16 * 1024)
+#define JOURNAL_MAX_RUN 64
+
+typedef struct JournalEvent
+{
+    uint32 seconds;
+    uint32 micros;
+    int16 x;
+    int16 y;
+    uint16 code;
+    uint16 qualifier;
+    uint8 eventClass;
+    uint8 subClass;
+} JournalEvent;
+
+// Single producer (input handler) / single consumer (main task) queue. The
+// producer fills a slot before publishing it in 'head', and the consumer is
+// done with a slot before giving it back in 'tail'.
+#define JOURNAL_BARRIER() __sync_synchronize()
+
+typedef struct JournalRing
+{
+    volatile uint32 head;
+    volatile uint32 tail;
+    volatile uint32 dropped;
+    JournalEvent events[JOURNAL_RING_SIZE];
+} JournalRing;
+
+typedef struct JournalWriter
+{
+    FILE* file;
+    uint64 lastTime;
+    size_t events;
+    size_t bytes;
+    size_t used;
+    uint32 runLength;
+    JournalEvent run[JOURNAL_MAX_RUN];
+    uint8 buffer[JOURNAL_BUFFER_SIZE];
+} JournalWriter;
+
+typedef struct JournalReader
+{
+    FILE* file;
+    uint64 lastTime;
+    size_t used;
+    size_t size;
+    uint32 runRemaining;
+    uint16 runQualifier;
+    BOOL eof;
+    uint8 buffer[JOURNAL_BUFFER_SIZE];
+} JournalReader;
+
+static inline void JournalRingPush(JournalRing* ring, const struct InputEvent* e)
+{
+    if (e->ie_Class == IECLASS_TIMER) {
+        return;
+    }
+
+    const uint32 head = ring->head;
+
+    if (head - ring->tail >= JOURNAL_RING_SIZE) {
+        ring->dropped++;
+        return;
+    }
+
+    JournalEvent* je = &ring->events[head & (JOURNAL_RING_SIZE - 1)];
+
+    je->seconds = e->ie_TimeStamp.Seconds;
+    je->micros = e->ie_TimeStamp.Microseconds;
+    je->x = e->ie_X;
+    je->y = e->ie_Y;
+    je->code = e->ie_Code;
+    je->qualifier = e->ie_Qualifier;
+    je->eventClass = e->ie_Class;
+    je->subClass = e->ie_SubClass;
+
+    JOURNAL_BARRIER();
+    ring->head = head + 1;
+}
+
+BOOL JournalWriterOpen(JournalWriter* jw, const char* const path);
+void JournalWriterAppend(JournalWriter* jw, const JournalEvent* je);
+size_t JournalWriterDrain(JournalWriter* jw, JournalRing* ring);
+void JournalWriterFlush(JournalWriter* jw);
+void JournalWriterClose(JournalWriter* jw);
+
+BOOL JournalReaderOpen(JournalReader* jr, const char* const path);
+BOOL JournalReaderNext(JournalReader* jr, JournalEvent* je);
+void JournalReaderClose(JournalReader* jr);
+
+void JournalEventToInputEvent(const JournalEvent* je, struct InputEvent* e);
+uint64 JournalEventTime(const JournalEvent* je);
@@ -29,215 +29,150 @@ SOFTWARE.
 #include "common.h"
 #include "version.h"
 #include "logger.h"
+#include "journal.h"
+#include "config.h"
+#include "sessions.h"
+#include "minuteindex.h"
+#include "rollup.h"
+#include "calendar.h"
+#include "history.h"
+#include "publish.h"
+#include "command.h"
+#include "metrics.h"
+#include "apps.h"
+#include "pool.h"
+#include "collectors.h"
 
 #include <proto/exec.h>
 #include <proto/dos.h>
+#include <proto/intuition.h>
 #include <devices/input.h>
+#include <intuition/intuitionbase.h>
+#include <dos/dosextens.h>
 
 #include <stdio.h>
-#include <math.h>
+#include <string.h>
 
 static const char* const stackString __attribute__((used)) = "$STACK:64000";
 static const char* const versionString __attribute__((used)) = "$VER:" VERSION_STRING;
 
-typedef struct Counter
-{
-    size_t left;
-    size_t middle;
-    size_t right;
-    size_t fourth;
-    size_t fifth;
-    size_t pixels;
-    size_t called;
-    size_t lastTime;
-    size_t keys;
-} Counter;
-
-typedef struct Statistics
-{
-    size_t startTime;
-    size_t startTimeCurrent;
-    size_t activeSecondsTotal;
-    size_t activeSeconds;
-    size_t breakSeconds;
-    size_t currentBreakDuration;
-    size_t breaks;
-    BOOL breakRegistered;
-} Statistics;
+Config config = {
+    NULL,
+    "PROGDIR:history",
+    NULL,
+    10,
+    1024,
+    MINUTE_INDEX_DAYS,
+    { 30, 50, 60 }
+};
 
 static Counter* counter;
-static Statistics stats;
-
-static const size_t BREAK_LENGTH = 5 * 60;
 
-char* PixelsString()
-{
-    static char buf[32];
-    snprintf(buf, sizeof(buf), "Pixels travelled: %u", counter->pixels);
-    return buf;
-}
+static JournalRing* ring;
+static JournalWriter journal;
 
-static size_t SecsToMins(size_t seconds)
-{
-    return seconds / 60;
-}
-
-static size_t ModMinute(size_t seconds)
-{
-    return seconds % 60;
-}
+static SnapshotPort* snapshotPort;
 
-static void InitStats()
+static void SendCommand(struct IOStdReq * req, struct Interrupt * is, const int command)
 {
-    if (stats.startTime == 0) {
-        stats.startTime = TimerGetSysTime().Seconds;
-        stats.startTimeCurrent = stats.startTime;
-        counter->lastTime = stats.startTime;
-    }
-}
+    //Log("Send command %d", command);
 
-static void CalculateTotalActivity()
-{
-    stats.activeSecondsTotal = counter->lastTime - stats.startTime;
-}
+    req->io_Command = command;
+    req->io_Data = is;
 
-static void Accumulate()
-{
-    const size_t delta = TimerGetSysTime().Seconds - counter->lastTime;
-    const BOOL passive = counter->lastTime ? delta > 4 : TRUE;
+    const int err = IExec->DoIO((struct IORequest *)req);
 
-    if (passive) {
-        stats.breakSeconds++;
-        stats.activeSeconds = 0;
-    } else {
-        stats.breakSeconds = 0;
-        stats.activeSeconds++;
+    if (err) {
+        Log("err %d, %d", err, req->io_Error);
     }
 }
 
-static void RegisterBreaks()
+static void CreateSnapshotPort()
 {
-    stats.currentBreakDuration = stats.breakSeconds;
+    IExec->Forbid();
+    const BOOL exists = IExec->FindPort(SNAPSHOT_PORT_NAME) != NULL;
+    IExec->Permit();
 
-    if (!stats.breakRegistered && stats.currentBreakDuration >= BREAK_LENGTH) {
-        stats.breaks++;
-        stats.breakRegistered = TRUE;
-    } else if (stats.breakRegistered && stats.currentBreakDuration < BREAK_LENGTH) {
-        stats.breakRegistered = FALSE;
+    if (exists) {
+        Log("Another meter is publishing a snapshot already");
+        return;
     }
-}
 
-void CalculateStats()
-{
-    CalculateTotalActivity();
-    Accumulate();
-    RegisterBreaks();
-}
+    // Not ASOPORT_Public, so that the port can be unlisted before it's freed
+    snapshotPort = IExec->AllocSysObjectTags(ASOT_PORT,
+        ASOPORT_Name, SNAPSHOT_PORT_NAME,
+        ASOPORT_Size, sizeof(SnapshotPort),
+        ASOPORT_AllocSig, FALSE,
+        TAG_DONE);
 
-char* AllActivityString()
-{
-    static char buf[64];
-    snprintf(buf, sizeof(buf), "All activity time: %u min %u secs",
-        SecsToMins(stats.activeSecondsTotal), ModMinute(stats.activeSecondsTotal));
-    return buf;
-}
+    if (!snapshotPort) {
+        puts("Failed to create snapshot port");
+        return;
+    }
 
-char* CurrentActivityString()
-{
-    static char buf[64];
-    snprintf(buf, sizeof(buf), "Current activity time: %u min %u secs",
-        SecsToMins(stats.activeSeconds), ModMinute(stats.activeSeconds));
-    return buf;
-}
+    snapshotPort->clients = 0;
+    PublishInit(&snapshotPort->snapshot, &localOffset);
+    StatsAddObserver(PublishOnTick, &snapshotPort->snapshot);
 
-char* BreakString()
-{
-    static char buf[64];
-    snprintf(buf, sizeof(buf), "Break time: %u min %u secs",
-        SecsToMins(stats.breakSeconds), ModMinute(stats.breakSeconds));
-    return buf;
+    IExec->AddPort(&snapshotPort->port);
 }
 
-char* TotalBreaksString()
+static void DeleteSnapshotPort(void)
 {
-    static char buf[32];
-    snprintf(buf, sizeof(buf), "Total breaks: %u", stats.breaks);
-    return buf;
-}
+    if (!snapshotPort) {
+        return;
+    }
 
-char* MouseCounterString()
-{
-    static char buf[64];
-    snprintf(buf, sizeof(buf), "LMB: %u, MMB: %u, RMB: %u, 4th: %u, 5th: %u",
-        counter->left, counter->middle, counter->right, counter->fourth, counter->fifth);
-    return buf;
-}
+    IExec->RemPort(&snapshotPort->port);
 
-char* KeyCounterString()
-{
-    static char buf[32];
-    snprintf(buf, sizeof(buf), "Keys pressed: %u", counter->keys);
-    return buf;
-}
-static struct InputEvent* InputEventHandler(struct InputEvent* events, APTR data)
-{
-    if (!(events && data)) {
-        return events;
+    // Give clients a few seconds to close it
+    for (int i = 0; i < 50 && snapshotPort->clients; i++) {
+        IDOS->Delay(5);
     }
 
-    struct InputEvent* e = events;
-    Counter* mc = (Counter *)data;
-
-    mc->called++;
-
-    while (e) {
-        if (e->ie_Class == IECLASS_RAWMOUSE) {
-            const int x = e->ie_X;
-            const int y = e->ie_Y;
-
-            mc->lastTime = e->ie_TimeStamp.Seconds;
-            mc->pixels += sqrt(x * x + y * y);
-
-            switch (e->ie_Code) {
-                case IECODE_LBUTTON:
-                    mc->left++;
-                    break;
-                case IECODE_MBUTTON:
-                    mc->middle++;
-                    break;
-                case IECODE_RBUTTON:
-                    mc->right++;
-                    break;
-                case IECODE_4TH_BUTTON:
-                    mc->fourth++;
-                    break;
-                case IECODE_5TH_BUTTON:
-                    mc->fifth++;
-                    break;
-            }
-        } else if (e->ie_Class == IECLASS_RAWKEY && !(e->ie_Code & IECODE_UP_PREFIX)) {
-            mc->lastTime = e->ie_TimeStamp.Seconds;
-            mc->keys++;
-        }
-
-        e = e->ie_NextEvent;
+    if (snapshotPort->clients) {
+        Log("%lu snapshot clients still open, leaving the snapshot allocated", snapshotPort->clients);
+        return;
     }
 
-    return events;
+    IExec->FreeSysObject(ASOT_PORT, snapshotPort);
+    snapshotPort = NULL;
 }
 
-static void SendCommand(struct IOStdReq * req, struct Interrupt * is, const int command)
+// Names the program behind the active window: the command of a CLI process,
+// otherwise the task or the window title. Runs on the stats tick, never in
+// the input handler.
+static BOOL SampleFocusedApplication(char* name, size_t size)
 {
-    //Log("Send command %d", command);
+    name[0] = '\0';
 
-    req->io_Command = command;
-    req->io_Data = is;
+    const uint32 lock = IIntuition->LockIBase(0);
+    const struct Window* w = ((struct IntuitionBase *)IntuitionBase)->ActiveWindow;
 
-    const int err = IExec->DoIO((struct IORequest *)req);
+    if (w) {
+        const struct Task* task = w->UserPort ? w->UserPort->mp_SigTask : NULL;
+        const struct CommandLineInterface* cli = NULL;
 
-    if (err) {
-        Log("err %d, %d", err, req->io_Error);
+        if (task && task->tc_Node.ln_Type == NT_PROCESS) {
+            cli = BADDR(((const struct Process *)task)->pr_CLI);
+        }
+
+        if (cli && cli->cli_Module && cli->cli_CommandName) {
+            const uint8* command = BADDR(cli->cli_CommandName);
+            snprintf(name, size, "%.*s", command[0], command + 1);
+        } else if (task && task->tc_Node.ln_Name) {
+            snprintf(name, size, "%s", task->tc_Node.ln_Name);
+        } else if (w->Title) {
+            snprintf(name, size, "%s", (const char *)w->Title);
+        }
     }
+
+    IIntuition->UnlockIBase(lock);
+
+    const char* file = IDOS->FilePart(name);
+    memmove(name, file, strlen(file) + 1);
+
+    return name[0] != '\0';
 }
 
 static void SetupHandler(struct IOStdReq * req)
@@ -252,7 +187,65 @@ static void SetupHandler(struct IOStdReq * req)
         return;
     }
 
-    InitStats();
+    counter->ring = ring;
+
+    struct Screen* screen = IIntuition->LockPubScreen(NULL);
+
+    if (screen) {
+        counter->screenWidth = screen->Width;
+        counter->screenHeight = screen->Height;
+        IIntuition->UnlockPubScreen(NULL, screen);
+    }
+
+    struct Preferences prefs;
+
+    if (IIntuition->GetPrefs(&prefs, sizeof(prefs))) {
+        counter->gestures.doubleClickMicros = prefs.DoubleClick.Seconds * 1000000 + prefs.DoubleClick.Microseconds;
+    }
+
+    InitStats(counter, MonotonicClock());
+
+    LocalOffsetUpdate();
+
+    if (!PoolInit(&pool, (size_t)config.memoryLimit * 1024)) {
+        puts("Failed to create memory pool");
+    }
+
+    SessionIndexInit(&sessionIndex, &pool, &localOffset, counter);
+    StatsAddObserver(SessionIndexOnTick, &sessionIndex);
+
+    MinutesInit(&minuteAggregator, &localOffset, counter);
+    StatsAddObserver(MinutesOnTick, &minuteAggregator);
+
+    if (MinuteIndexInit(&minuteIndex, config.indexDays)) {
+        MinutesAddObserver(&minuteAggregator, MinuteIndexOnMinute, &minuteIndex);
+    } else {
+        puts("Failed to allocate minute index");
+    }
+
+    RollupsInit(&rollups);
+    RollupsAdvance(&rollups, (ClockSeconds(MonotonicClock()) + localOffset) / SECONDS_PER_DAY);
+    MinutesAddObserver(&minuteAggregator, RollupsOnMinute, &rollups);
+
+    if (config.historyPath && HistoryInit(&history, config.historyPath)) {
+        MinutesAddObserver(&minuteAggregator, HistoryOnMinute, &history);
+    } else {
+        config.historyPath = NULL;
+    }
+
+    AppsInit(&appTable, SampleFocusedApplication, counter);
+    StatsAddObserver(AppsOnTick, &appTable);
+
+    if (config.historyPath) {
+        AppsLoad(&appTable, config.historyPath);
+    }
+
+    CreateSnapshotPort();
+    CommandInit(counter, MonotonicClock(), &localOffset, config.historyPath, FlushRecording);
+
+    if (config.metricsPath) {
+        MetricsInit(config.metricsPath, counter, MonotonicClock(), &localOffset, &timerQueue);
+    }
 
     struct Interrupt* is = (struct Interrupt *)IExec->AllocSysObjectTags(ASOT_INTERRUPT,
         ASOINTR_Code, InputEventHandler,
@@ -269,6 +262,14 @@ static void SetupHandler(struct IOStdReq * req)
 
         SendCommand(req, is, IND_REMHANDLER);
 
+        DeleteSnapshotPort();
+
+        MinutesFlush(&minuteAggregator);
+
+        if (config.historyPath && !AppsSave(&appTable)) {
+            Log("Failed to save application activity to '%s'", appTable.path);
+        }
+
         IExec->FreeSysObject(ASOT_INTERRUPT, is);
 
         Log("Stats: left %zu, middle %zu, right %zu. Distance %zu pixels, called %zu times, keys %zu",
@@ -278,13 +279,86 @@ static void SetupHandler(struct IOStdReq * req)
             counter->pixels,
             counter->called,
             counter->keys);
+
+        for (int i = 0; i < EPointerSource_Count; i++) {
+            if (counter->pointers[i].events) {
+                Log("Pointer %s: %zu events, %zu pixels", pointerSourceNames[i], counter->pointers[i].events,
+                    counter->pointers[i].pixels);
+            }
+        }
+
+        Log("Gestures: %zu clicks, %zu double-clicks, %zu drags over %zu pixels in %llu ms, %zu pixels moved freely",
+            counter->gestures.clicks, counter->gestures.doubleClicks, counter->gestures.drags,
+            counter->gestures.dragPixels, counter->gestures.dragMicros / 1000, counter->gestures.movePixels);
+
+        Log("Sessions: %zu stored, %zu merged", sessionIndex.count, sessionIndex.merges);
+        Log("Applications: %zu tracked, %zu evicted", appTable.count, appTable.evictions);
+
+        Log("Memory pool: %zu of %zu KB reserved, %zu bytes used, peak %zu, %zu allocations, %zu evictions, "
+            "%zu failures", pool.stats.reserved / 1024, pool.cap / 1024, pool.stats.used, pool.stats.peak,
+            pool.stats.allocations, pool.stats.evictions, pool.stats.failures);
+
+        if (history.compactedBlocks) {
+            Log("History: %zu minutes appended, %zu blocks compacted from %zu to %zu bytes",
+                history.appended, history.compactedBlocks, history.rawBytes, history.compactedBytes);
+        }
+
+        if (history.combined || history.dropped) {
+            Log("History: %zu minutes before the last one combined, %zu dropped", history.combined, history.dropped);
+        }
     } else {
         puts("Failed to allocate interrupt");
     }
 
+    SessionIndexQuit(&sessionIndex);
+    MinuteIndexQuit(&minuteIndex);
+    PoolQuit(&pool);
+
     IExec->FreeVec(counter);
 }
 
+void FlushRecording()
+{
+    if (ring) {
+        JournalWriterDrain(&journal, ring);
+        JournalWriterFlush(&journal);
+    }
+}
+
+static void StartRecording(const char* const path)
+{
+    if (!JournalWriterOpen(&journal, path)) {
+        return;
+    }
+
+    ring = IExec->AllocVecTags(sizeof(JournalRing),
+        AVT_Type, MEMF_SHARED,
+        AVT_ClearWithValue, 0,
+        TAG_DONE);
+
+    if (!ring) {
+        puts("Failed to allocate journal ring");
+        JournalWriterClose(&journal);
+        return;
+    }
+
+    Log("Recording input events to '%s'", path);
+}
+
+static void StopRecording()
+{
+    if (ring) {
+        FlushRecording();
+
+        Log("Recorded %zu events in %zu bytes, %lu dropped", journal.events, journal.bytes, ring->dropped);
+
+        JournalWriterClose(&journal);
+
+        IExec->FreeVec(ring);
+        ring = NULL;
+    }
+}
+
 static void CheckStack()
 {
     struct Task* task = IExec->FindTask(NULL);
@@ -306,6 +380,50 @@ int main(void)
         return -1;
     }
 
+    enum { ARG_Record, ARG_History, ARG_Metrics, ARG_MetricsInterval, ARG_Memory, ARG_IndexDays, ARG_MicroPause, ARG_LongBreak, ARG_BreakWindow, ARG_Count };
+
+    int32 args[ARG_Count] = { 0 };
+    struct RDArgs* rda = IDOS->ReadArgs("RECORD/K,HISTORY/K,METRICS/K,METRICSINTERVAL/K/N,MEMORY/K/N,INDEXDAYS/K/N,MICROPAUSE/K/N,LONGBREAK/K/N,BREAKWINDOW/K/N", args, NULL);
+
+    if (rda) {
+        if (args[ARG_Record]) {
+            config.recordPath = (const char *)args[ARG_Record];
+        }
+        if (args[ARG_History]) {
+            config.historyPath = (const char *)args[ARG_History];
+        }
+        if (args[ARG_Metrics]) {
+            config.metricsPath = (const char *)args[ARG_Metrics];
+        }
+        if (args[ARG_MetricsInterval] && *(int32 *)args[ARG_MetricsInterval] > 0) {
+            config.metricsInterval = *(int32 *)args[ARG_MetricsInterval];
+        }
+        if (args[ARG_Memory] && *(int32 *)args[ARG_Memory] > 0) {
+            config.memoryLimit = *(int32 *)args[ARG_Memory];
+        }
+        if (args[ARG_IndexDays] && *(int32 *)args[ARG_IndexDays] > 0) {
+            config.indexDays = *(int32 *)args[ARG_IndexDays];
+        }
+        if (args[ARG_MicroPause]) {
+            config.reminder.microPauseAfter = *(int32 *)args[ARG_MicroPause];
+        }
+        if (args[ARG_LongBreak]) {
+            config.reminder.longBreakAfter = *(int32 *)args[ARG_LongBreak];
+        }
+        if (args[ARG_BreakWindow]) {
+            config.reminder.longBreakWindow = *(int32 *)args[ARG_BreakWindow];
+        }
+    }
+
+    if (config.recordPath && !COLLECT_JOURNAL) {
+        Log("Built without the journal collector, RECORD is ignored");
+        config.recordPath = NULL;
+    }
+
+    if (config.recordPath) {
+        StartRecording(config.recordPath);
+    }
+
     struct MsgPort* port = IExec->AllocSysObjectTags(ASOT_PORT,
         ASOPORT_Name, "id_port",
         TAG_DONE);
@@ -336,6 +454,12 @@ int main(void)
         puts("Failed to allocate message port");
     }
 
+    StopRecording();
+
+    if (rda) {
+        IDOS->FreeArgs(rda);
+    }
+
     TimerQuit(&timer);
 
     CheckStack();
@@ -0,0 +1,168 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "merge.h"
+
+// Binary min-heap of input indices ordered by the minute of their current
+// record, ties by input order. Taking a record costs O(log k), so merging
+// n records from k inputs takes O(n log k).
+
+const char* const mergeRuleNames[EMergeRule_Count] = { "sum", "max" };
+
+static BOOL Before(const Merge* m, int a, int b)
+{
+    const uint32 minuteA = m->inputs[m->heap[a]].head.minute;
+    const uint32 minuteB = m->inputs[m->heap[b]].head.minute;
+
+    return minuteA < minuteB || (minuteA == minuteB && m->heap[a] < m->heap[b]);
+}
+
+static void Swap(Merge* m, int a, int b)
+{
+    const int index = m->heap[a];
+
+    m->heap[a] = m->heap[b];
+    m->heap[b] = index;
+}
+
+static void SiftUp(Merge* m, int index)
+{
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+
+        if (!Before(m, index, parent)) {
+            break;
+        }
+
+        Swap(m, parent, index);
+        index = parent;
+    }
+}
+
+static void SiftDown(Merge* m, int index)
+{
+    while (TRUE) {
+        const int left = 2 * index + 1;
+        const int right = left + 1;
+        int smallest = index;
+
+        if (left < m->count && Before(m, left, smallest)) {
+            smallest = left;
+        }
+
+        if (right < m->count && Before(m, right, smallest)) {
+            smallest = right;
+        }
+
+        if (smallest == index) {
+            break;
+        }
+
+        Swap(m, smallest, index);
+        index = smallest;
+    }
+}
+
+// Replaces the top input's record with its next one, or drops the input
+static void Advance(Merge* m)
+{
+    MergeInput* input = &m->inputs[m->heap[0]];
+
+    if (!input->next(input->source, &input->head)) {
+        m->heap[0] = m->heap[--m->count];
+    }
+
+    if (m->count) {
+        SiftDown(m, 0);
+    }
+}
+
+static void Combine(EMergeRule rule, MinuteRecord* record, const MinuteRecord* other)
+{
+    for (int i = 0; i < EMetric_Count; i++) {
+        if (rule == EMergeRule_Max) {
+            if (other->values[i] > record->values[i]) {
+                record->values[i] = other->values[i];
+            }
+        } else {
+            record->values[i] += other->values[i];
+        }
+    }
+
+    if (record->values[EMetric_Active] > 60) {
+        record->values[EMetric_Active] = 60;
+    }
+}
+
+void MergeInit(Merge* m, EMergeRule rule)
+{
+    m->count = 0;
+    m->inputCount = 0;
+    m->rule = rule;
+    m->records = 0;
+    m->duplicates = 0;
+}
+
+BOOL MergeAddInput(Merge* m, MergeSourceNext next, void* source)
+{
+    if (m->inputCount >= MERGE_MAX_INPUTS) {
+        return FALSE;
+    }
+
+    MergeInput* input = &m->inputs[m->inputCount];
+
+    input->next = next;
+    input->source = source;
+
+    if (next(source, &input->head)) {
+        m->heap[m->count] = m->inputCount;
+        SiftUp(m, m->count++);
+    }
+
+    m->inputCount++;
+
+    return TRUE;
+}
+
+BOOL MergeNext(Merge* m, MinuteRecord* record)
+{
+    if (!m->count) {
+        return FALSE;
+    }
+
+    *record = m->inputs[m->heap[0]].head;
+    Advance(m);
+
+    while (m->count && m->inputs[m->heap[0]].head.minute == record->minute) {
+        Combine(m->rule, record, &m->inputs[m->heap[0]].head);
+        Advance(m);
+        m->duplicates++;
+    }
+
+    m->records++;
+
+    return TRUE;
+}
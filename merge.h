@@ -0,0 +1,67 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "minutes.h"
+
+// Streaming k-way merge of time-ordered minute record sources. Each input
+// holds one record at a time, so memory use only depends on the number of
+// inputs.
+
+#define MERGE_MAX_INPUTS 64
+
+typedef enum EMergeRule {
+    EMergeRule_Sum, // Counters are added, active time is capped at a minute
+    EMergeRule_Max, // Every value is the largest of the inputs
+    EMergeRule_Count // KEEP LAST
+} EMergeRule;
+
+typedef BOOL (*MergeSourceNext)(void* source, MinuteRecord* record);
+
+typedef struct MergeInput
+{
+    MergeSourceNext next;
+    void* source;
+    MinuteRecord head;
+} MergeInput;
+
+typedef struct Merge
+{
+    MergeInput inputs[MERGE_MAX_INPUTS];
+    int heap[MERGE_MAX_INPUTS];
+    int count;
+    int inputCount;
+    EMergeRule rule;
+    size_t records;
+    size_t duplicates;
+} Merge;
+
+extern const char* const mergeRuleNames[EMergeRule_Count];
+
+void MergeInit(Merge* m, EMergeRule rule);
+BOOL MergeAddInput(Merge* m, MergeSourceNext next, void* source);
+BOOL MergeNext(Merge* m, MinuteRecord* record);
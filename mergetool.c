@@ -0,0 +1,262 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Merges the minute histories of several machines into one timeline.
+// Minutes recorded on more than one machine are combined by a rule.
+
+#include "merge.h"
+#include "history.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Generated input for testing the merge at scale without files
+typedef struct Generator
+{
+    uint32 minute;
+    uint32 left;
+    uint32 seed;
+    uint64 keys;
+} Generator;
+
+static double Elapsed(const struct timespec* since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+static uint32 Random(Generator* g)
+{
+    g->seed = g->seed * 1103515245 + 12345;
+    return g->seed >> 16;
+}
+
+static BOOL GeneratorNext(void* source, MinuteRecord* record)
+{
+    Generator* g = (Generator *)source;
+
+    if (!g->left) {
+        return FALSE;
+    }
+
+    g->left--;
+    g->minute += 1 + Random(g) % 3;
+
+    record->minute = g->minute;
+    for (int i = 0; i < EMetric_Count; i++) {
+        record->values[i] = Random(g) % 20;
+    }
+    record->values[EMetric_Active] = 1 + Random(g) % 60;
+
+    g->keys += record->values[EMetric_Keys];
+
+    return TRUE;
+}
+
+static BOOL ReaderNext(void* source, MinuteRecord* record)
+{
+    return HistoryReaderNext((HistoryReader *)source, record);
+}
+
+// Writes the merged timeline and checks that it's strictly ordered
+static int Run(Merge* m, const char* const outputPath, uint64* keys)
+{
+    MinuteRecord record;
+    uint32 previous = 0;
+    size_t unordered = 0;
+
+    if (outputPath && !HistoryCreate(&history, outputPath)) {
+        return 1;
+    }
+
+    *keys = 0;
+
+    while (MergeNext(m, &record)) {
+        if (m->records > 1 && record.minute <= previous) {
+            unordered++;
+        }
+
+        previous = record.minute;
+        *keys += record.values[EMetric_Keys];
+
+        if (outputPath && !HistoryWrite(&history, &record)) {
+            printf("Failed to write history '%s'\n", outputPath);
+            return 1;
+        }
+    }
+
+    if (outputPath && !HistoryWriteFinish(&history)) {
+        printf("Failed to write history '%s'\n", outputPath);
+        return 1;
+    }
+
+    if (unordered) {
+        printf("%zu records out of order\n", unordered);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int Synthetic(EMergeRule rule, int inputs, uint32 records, const char* const outputPath)
+{
+    static Merge merge;
+    static Generator generators[MERGE_MAX_INPUTS];
+    uint64 inputKeys = 0;
+    uint64 outputKeys;
+
+    if (inputs < 1 || inputs > MERGE_MAX_INPUTS) {
+        printf("Between 1 and %d inputs\n", MERGE_MAX_INPUTS);
+        return 1;
+    }
+
+    MergeInit(&merge, rule);
+
+    for (int i = 0; i < inputs; i++) {
+        generators[i].minute = 20000 * 24 * 60 + i * 7;
+        generators[i].left = records;
+        generators[i].seed = i + 1;
+        generators[i].keys = 0;
+
+        MergeAddInput(&merge, GeneratorNext, &generators[i]);
+    }
+
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    const int result = Run(&merge, outputPath, &outputKeys);
+    const double elapsed = Elapsed(&started);
+
+    for (int i = 0; i < inputs; i++) {
+        inputKeys += generators[i].keys;
+    }
+
+    const size_t total = (size_t)inputs * records;
+
+    printf("%d inputs, %zu records: %zu merged records, %zu duplicates, %.1f ns per input record\n",
+        inputs, total, merge.records, merge.duplicates, elapsed * 1e9 / total);
+
+    if (merge.records + merge.duplicates != total) {
+        puts("Record count mismatch");
+        return 1;
+    }
+
+    if (rule == EMergeRule_Sum ? outputKeys != inputKeys : outputKeys > inputKeys) {
+        printf("Key checksum mismatch: %llu in, %llu out\n",
+            (unsigned long long)inputKeys, (unsigned long long)outputKeys);
+        return 1;
+    }
+
+    return result;
+}
+
+static void Usage(const char* const name)
+{
+    printf("Usage: %s [-rule sum|max] -output <base path> <history base path>...\n", name);
+    printf("       %s [-rule sum|max] [-output <base path>] -synthetic <inputs> <records per input>\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+    static Merge merge;
+    static HistoryReader* readers[MERGE_MAX_INPUTS];
+
+    EMergeRule rule = EMergeRule_Sum;
+    const char* outputPath = NULL;
+    int first = 1;
+
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (strcmp(argv[first], "-rule") == 0 && first + 1 < argc) {
+            const char* const name = argv[++first];
+
+            for (rule = 0; rule < EMergeRule_Count && strcmp(name, mergeRuleNames[rule]) != 0; rule++) {
+            }
+
+            if (rule == EMergeRule_Count) {
+                Usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[first], "-output") == 0 && first + 1 < argc) {
+            outputPath = argv[++first];
+        } else if (strcmp(argv[first], "-synthetic") == 0 && first + 2 < argc) {
+            return Synthetic(rule, atoi(argv[first + 1]), atoi(argv[first + 2]), outputPath);
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    const int inputs = argc - first;
+
+    if (!outputPath || inputs < 1) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (inputs > MERGE_MAX_INPUTS) {
+        printf("At most %d inputs\n", MERGE_MAX_INPUTS);
+        return 1;
+    }
+
+    MergeInit(&merge, rule);
+
+    int result = 0;
+
+    for (int i = 0; i < inputs && !result; i++) {
+        readers[i] = malloc(sizeof(HistoryReader));
+
+        if (!readers[i] || !HistoryReaderOpen(readers[i], argv[first + i])) {
+            printf("No history found at '%s'\n", argv[first + i]);
+            result = 1;
+        } else {
+            MergeAddInput(&merge, ReaderNext, readers[i]);
+        }
+    }
+
+    uint64 keys;
+
+    if (!result) {
+        result = Run(&merge, outputPath, &keys);
+    }
+
+    if (!result) {
+        printf("Merged %d histories: %zu records, %zu duplicate minutes combined (%s), %llu keys\n",
+            inputs, merge.records, merge.duplicates, mergeRuleNames[rule], (unsigned long long)keys);
+    }
+
+    for (int i = 0; i < inputs; i++) {
+        if (readers[i]) {
+            HistoryReaderClose(readers[i]);
+            free(readers[i]);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,207 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "metrics.h"
+#include "minuteindex.h"
+#include "rollup.h"
+#include "files.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RATE_MINUTES 5
+
+// Values that decide whether the file needs rewriting. Gauges derived from
+// the time of day are left out so that an idle meter doesn't write.
+typedef struct MetricsState
+{
+    size_t activeTotal;
+    size_t breaks;
+    size_t lastActive;
+    size_t left;
+    size_t middle;
+    size_t right;
+    size_t fourth;
+    size_t fifth;
+    size_t pixels;
+    size_t keys;
+} MetricsState;
+
+static const Counter* counter;
+static Clock* timeSource;
+static const int64* offset;
+static const TimerQueue* queue;
+
+static char path[METRICS_PATH_LENGTH];
+static char tempPath[METRICS_PATH_LENGTH + 4];
+static char buffer[METRICS_BUFFER_SIZE];
+static size_t length;
+
+static MetricsState written;
+static BOOL hasWritten;
+static size_t writes;
+static size_t unchanged;
+static uint64 lastWriteTime; // Microseconds
+
+static void Append(const char* const fmt, ...) __attribute__ ((format (printf, 1, 2)));
+
+static void Append(const char* const fmt, ...)
+{
+    if (length >= sizeof(buffer)) {
+        return;
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    const int len = vsnprintf(buffer + length, sizeof(buffer) - length, fmt, ap);
+    va_end(ap);
+
+    length += len > 0 ? (size_t)len : 0;
+}
+
+// Counter samples get the _total suffix that OpenMetrics expects
+static void Metric(const char* const name, const char* const type, const char* const help, uint64 value)
+{
+    const BOOL isCounter = strcmp(type, "counter") == 0;
+
+    Append("# HELP %s %s\n# TYPE %s %s\n%s%s %llu\n", name, help, name, type, name, isCounter ? "_total" : "",
+        (unsigned long long)value);
+}
+
+static void Format(const MetricsState* s, const StatsSummary* summary)
+{
+    static const char* const buttons[] = { "left", "middle", "right", "fourth", "fifth" };
+    const size_t clicks[] = { s->left, s->middle, s->right, s->fourth, s->fifth };
+
+    length = 0;
+
+    Metric("activitymeter_active_seconds", "counter", "Time with input activity.", s->activeTotal);
+    Metric("activitymeter_breaks", "counter", "Breaks of at least five minutes.", s->breaks);
+    Metric("activitymeter_keys", "counter", "Keys pressed.", s->keys);
+    Metric("activitymeter_pointer_pixels", "counter", "Distance travelled by the pointer.", s->pixels);
+
+    Append("# HELP activitymeter_clicks Mouse button presses.\n# TYPE activitymeter_clicks counter\n");
+    for (size_t i = 0; i < sizeof(buttons) / sizeof(buttons[0]); i++) {
+        Append("activitymeter_clicks_total{button=\"%s\"} %zu\n", buttons[i], clicks[i]);
+    }
+
+    Metric("activitymeter_handler_calls", "counter", "Input handler calls, one per event list.", counter->called);
+
+    Metric("activitymeter_last_active_timestamp_seconds", "gauge",
+        "Local time of the latest activity, seconds since 1.1.1970.", s->lastActive + *offset);
+    Metric("activitymeter_current_activity_seconds", "gauge", "Length of the current activity period.",
+        summary->activeSeconds);
+    Metric("activitymeter_today_active_seconds", "gauge", "Activity today, up to the last closed minute.",
+        RollupsGet(&rollups, EPeriod_Day, 0)->values[EMetric_Active]);
+
+    // Rates over the last closed minutes
+    const uint32 now = (uint32)((ClockSeconds(timeSource) + *offset) / 60);
+
+    Metric("activitymeter_keys_per_minute", "gauge", "Keys per minute over the last 5 minutes.",
+        MinuteIndexSum(&minuteIndex, EMetric_Keys, now - RATE_MINUTES, now) / RATE_MINUTES);
+    Metric("activitymeter_pixels_per_minute", "gauge", "Pointer pixels per minute over the last 5 minutes.",
+        MinuteIndexSum(&minuteIndex, EMetric_Pixels, now - RATE_MINUTES, now) / RATE_MINUTES);
+
+    if (queue) {
+        Metric("activitymeter_timer_wakeups", "counter", "Timer device wakeups.", queue->wakeups);
+        Metric("activitymeter_timers_fired", "counter", "Logical timers fired.", queue->fired);
+    }
+
+    Metric("activitymeter_metrics_writes", "counter", "Times this file was written.", writes + 1);
+    Metric("activitymeter_metrics_unchanged", "counter", "Checks that found nothing to write.", unchanged);
+    Metric("activitymeter_metrics_write_microseconds", "gauge", "Time the previous write took.", lastWriteTime);
+
+    Append("# EOF\n");
+}
+
+void MetricsInit(const char* const metricsPath, const Counter* c, Clock* clock, const int64* timeOffset,
+    const TimerQueue* timerQueue)
+{
+    counter = c;
+    timeSource = clock;
+    offset = timeOffset;
+    queue = timerQueue;
+
+    snprintf(path, sizeof(path), "%s", metricsPath);
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    hasWritten = FALSE;
+    writes = 0;
+    unchanged = 0;
+}
+
+BOOL MetricsWrite()
+{
+    const uint64 started = ClockNow(timeSource);
+    StatsSummary summary;
+    MetricsState state;
+
+    StatsGetSummary(&summary);
+
+    memset(&state, 0, sizeof(state));
+    state.activeTotal = summary.activeSecondsTotal;
+    state.breaks = summary.breaks;
+    state.lastActive = summary.lastActive;
+    state.left = counter->left;
+    state.middle = counter->middle;
+    state.right = counter->right;
+    state.fourth = counter->fourth;
+    state.fifth = counter->fifth;
+    state.pixels = counter->pixels;
+    state.keys = counter->keys;
+
+    if (hasWritten && memcmp(&state, &written, sizeof(state)) == 0) {
+        unchanged++;
+        return FALSE;
+    }
+
+    Format(&state, &summary);
+
+    FILE* file = fopen(tempPath, "wb");
+
+    if (!file) {
+        return FALSE;
+    }
+
+    const BOOL ok = fwrite(buffer, 1, length, file) == length;
+
+    if (fclose(file) != 0 || !ok) {
+        remove(tempPath);
+        return FALSE;
+    }
+
+    if (!ReplaceFile(tempPath, path)) {
+        return FALSE;
+    }
+
+    written = state;
+    hasWritten = TRUE;
+    writes++;
+    lastWriteTime = ClockNow(timeSource) - started;
+
+    return TRUE;
+}
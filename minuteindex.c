@@ -0,0 +1,230 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "minuteindex.h"
+
+#include <string.h>
+
+#ifdef __amigaos4__
+#include <proto/exec.h>
+#else
+#include <stdlib.h>
+#endif
+
+MinuteIndex minuteIndex;
+
+// Column of a metric other than pixels in the shared nodes
+static int CountColumn(EMetric metric)
+{
+    return metric < EMetric_Pixels ? metric : metric - 1;
+}
+
+// Tree positions are 1-based slot numbers. Removing a value wraps the
+// 32-bit nodes back to their exact sums.
+static void Update(MinuteIndex* mi, uint32 slot, EMetric metric, uint64 delta)
+{
+    if (metric == EMetric_Pixels) {
+        for (uint32 i = slot + 1; i <= mi->capacity; i += i & -i) {
+            mi->pixels[i] += delta;
+        }
+    } else {
+        const int column = CountColumn(metric);
+
+        for (uint32 i = slot + 1; i <= mi->capacity; i += i & -i) {
+            mi->counts[i][column] += (uint32)delta;
+        }
+    }
+}
+
+static uint64 Prefix(const MinuteIndex* mi, uint32 slots, EMetric metric)
+{
+    uint64 sum = 0;
+
+    if (metric == EMetric_Pixels) {
+        for (uint32 i = slots; i > 0; i -= i & -i) {
+            sum += mi->pixels[i];
+        }
+    } else {
+        const int column = CountColumn(metric);
+
+        for (uint32 i = slots; i > 0; i -= i & -i) {
+            sum += mi->counts[i][column];
+        }
+    }
+
+    return sum;
+}
+
+static uint64 PointValue(const MinuteIndex* mi, uint32 slot, EMetric metric)
+{
+    return Prefix(mi, slot + 1, metric) - Prefix(mi, slot, metric);
+}
+
+static size_t TreeSize(uint32 capacity)
+{
+    return (capacity + 1) * (sizeof(uint64) + sizeof(uint32[EMetric_Count - 1]));
+}
+
+static void Clear(MinuteIndex* mi)
+{
+    memset(mi->pixels, 0, TreeSize(mi->capacity));
+}
+
+BOOL MinuteIndexInit(MinuteIndex* mi, uint32 days)
+{
+    memset(mi, 0, sizeof(*mi));
+
+    if (days < 1) {
+        days = 1;
+    } else if (days > MINUTE_INDEX_MAX_DAYS) {
+        days = MINUTE_INDEX_MAX_DAYS;
+    }
+
+    mi->capacity = days * 24 * 60;
+
+    // Pixel nodes first, which keeps them aligned
+#ifdef __amigaos4__
+    mi->pixels = IExec->AllocVecTags(TreeSize(mi->capacity),
+        AVT_Type, MEMF_PRIVATE,
+        AVT_ClearWithValue, 0,
+        TAG_DONE);
+#else
+    mi->pixels = calloc(1, TreeSize(mi->capacity));
+#endif
+
+    if (!mi->pixels) {
+        mi->capacity = 0;
+        return FALSE;
+    }
+
+    mi->counts = (uint32 (*)[EMetric_Count - 1])(mi->pixels + mi->capacity + 1);
+
+    return TRUE;
+}
+
+void MinuteIndexQuit(MinuteIndex* mi)
+{
+#ifdef __amigaos4__
+    IExec->FreeVec(mi->pixels);
+#else
+    free(mi->pixels);
+#endif
+
+    memset(mi, 0, sizeof(*mi));
+}
+
+uint32 MinuteIndexOldest(const MinuteIndex* mi)
+{
+    if (!mi->started) {
+        return 0xFFFFFFFF;
+    }
+
+    const uint32 oldest = mi->newest >= mi->capacity - 1 ? mi->newest - (mi->capacity - 1) : 0;
+
+    return oldest > mi->first ? oldest : mi->first;
+}
+
+// Recycles the slots of minutes that fall out of the window
+static void AdvanceTo(MinuteIndex* mi, uint32 minute)
+{
+    if (!mi->started || minute - mi->newest >= mi->capacity) {
+        Clear(mi);
+        mi->started = TRUE;
+        mi->first = minute;
+        mi->newest = minute;
+        return;
+    }
+
+    while (mi->newest < minute) {
+        mi->newest++;
+
+        const uint32 slot = mi->newest % mi->capacity;
+
+        for (int m = 0; m < EMetric_Count; m++) {
+            const uint64 old = PointValue(mi, slot, m);
+
+            if (old) {
+                Update(mi, slot, m, -old);
+            }
+        }
+    }
+}
+
+void MinuteIndexAdd(MinuteIndex* mi, const MinuteRecord* record)
+{
+    if (!mi->capacity) {
+        return;
+    }
+
+    if (!mi->started || record->minute > mi->newest) {
+        AdvanceTo(mi, record->minute);
+    } else if (record->minute < MinuteIndexOldest(mi)) {
+        return;
+    }
+
+    const uint32 slot = record->minute % mi->capacity;
+
+    for (int m = 0; m < EMetric_Count; m++) {
+        if (record->values[m]) {
+            Update(mi, slot, m, record->values[m]);
+        }
+    }
+}
+
+void MinuteIndexOnMinute(const MinuteRecord* record, void* userData)
+{
+    MinuteIndexAdd((MinuteIndex *)userData, record);
+}
+
+uint64 MinuteIndexSum(const MinuteIndex* mi, EMetric metric, uint32 from, uint32 to)
+{
+    if (!mi->started) {
+        return 0;
+    }
+
+    const uint32 oldest = MinuteIndexOldest(mi);
+
+    if (from < oldest) {
+        from = oldest;
+    }
+
+    if (to > mi->newest + 1) {
+        to = mi->newest + 1;
+    }
+
+    if (from >= to) {
+        return 0;
+    }
+
+    const uint32 first = from % mi->capacity;
+    const uint32 end = (to - 1) % mi->capacity + 1;
+
+    if (first < end) {
+        return Prefix(mi, end, metric) - Prefix(mi, first, metric);
+    }
+
+    return Prefix(mi, mi->capacity, metric) - Prefix(mi, first, metric) + Prefix(mi, end, metric);
+}
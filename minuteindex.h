@@ -0,0 +1,63 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "minutes.h"
+
+#define MINUTE_INDEX_DAYS 7 // Default retention
+#define MINUTE_INDEX_MAX_DAYS 366
+
+// Fenwick trees over a ring of per-minute buckets, one per metric,
+// allocated for the retention given to MinuteIndexInit(). Both closing a
+// minute and summing an arbitrary range of the retained minutes cost
+// O(log n). A node covers up to half a year of minutes: pixels from a fast
+// mouse overflow 32 bits in that time, so only the pixel tree has 64-bit
+// nodes. The other metrics share 32-bit nodes, interleaved per node.
+typedef struct MinuteIndex
+{
+    BOOL started;
+    uint32 first; // Oldest minute added since the index was started
+    uint32 newest;
+    uint32 capacity; // Minutes
+    uint64* pixels;
+    uint32 (*counts)[EMetric_Count - 1];
+} MinuteIndex;
+
+extern MinuteIndex minuteIndex;
+
+BOOL MinuteIndexInit(MinuteIndex* mi, uint32 days);
+void MinuteIndexQuit(MinuteIndex* mi);
+void MinuteIndexAdd(MinuteIndex* mi, const MinuteRecord* record);
+void MinuteIndexOnMinute(const MinuteRecord* record, void* userData);
+
+// Sum over minutes [from, to). Minutes before MinuteIndexOldest() count as
+// zero, look them up in the history instead.
+uint64 MinuteIndexSum(const MinuteIndex* mi, EMetric metric, uint32 from, uint32 to);
+
+// The oldest minute the index covers, which is after every minute if
+// nothing has been added yet
+uint32 MinuteIndexOldest(const MinuteIndex* mi);
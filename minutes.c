@@ -0,0 +1,142 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "minutes.h"
+
+#include <string.h>
+
+MinuteAggregator minuteAggregator;
+
+const char* const metricNames[EMetric_Count] = {
+    "active",
+    "left",
+    "middle",
+    "right",
+    "fourth",
+    "fifth",
+    "pixels",
+    "keys"
+};
+
+static void ReadCounter(const Counter* counter, size_t* values)
+{
+    values[EMetric_Active] = 0;
+    values[EMetric_Left] = counter->left;
+    values[EMetric_Middle] = counter->middle;
+    values[EMetric_Right] = counter->right;
+    values[EMetric_Fourth] = counter->fourth;
+    values[EMetric_Fifth] = counter->fifth;
+    values[EMetric_Pixels] = counter->pixels;
+    values[EMetric_Keys] = counter->keys;
+}
+
+void MinutesInit(MinuteAggregator* ma, const int64* timeOffset, const Counter* counter)
+{
+    memset(ma, 0, sizeof(*ma));
+
+    ma->timeOffset = timeOffset;
+
+    ReadCounter(counter, ma->last);
+}
+
+BOOL MinutesAddObserver(MinuteAggregator* ma, MinuteObserver observer, void* userData)
+{
+    if (ma->observerCount >= MAX_MINUTE_OBSERVERS) {
+        return FALSE;
+    }
+
+    ma->observers[ma->observerCount].observer = observer;
+    ma->observers[ma->observerCount].userData = userData;
+    ma->observerCount++;
+
+    return TRUE;
+}
+
+static BOOL IsEmpty(const MinuteRecord* record)
+{
+    for (int i = 0; i < EMetric_Count; i++) {
+        if (record->values[i]) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+void MinutesFlush(MinuteAggregator* ma)
+{
+    if (!ma->started || IsEmpty(&ma->current)) {
+        return;
+    }
+
+    for (size_t i = 0; i < ma->observerCount; i++) {
+        ma->observers[i].observer(&ma->current, ma->observers[i].userData);
+    }
+
+    memset(ma->current.values, 0, sizeof(ma->current.values));
+}
+
+static void SwitchTo(MinuteAggregator* ma, uint32 minute)
+{
+    if (!ma->started) {
+        ma->started = TRUE;
+    } else if (minute > ma->current.minute) {
+        MinutesFlush(ma);
+    } else {
+        return;
+    }
+
+    ma->current.minute = minute;
+}
+
+void MinutesOnTick(const StatsTick* tick, void* userData)
+{
+    MinuteAggregator* ma = (MinuteAggregator *)userData;
+
+    const size_t from = tick->from + *ma->timeOffset;
+    const size_t now = tick->now + *ma->timeOffset;
+    const size_t activeEnd = from + tick->active;
+
+    for (size_t t = from; t < activeEnd; ) {
+        const size_t minuteEnd = (t / 60 + 1) * 60;
+        const size_t chunk = (activeEnd < minuteEnd ? activeEnd : minuteEnd) - t;
+
+        SwitchTo(ma, t / 60);
+        ma->current.values[EMetric_Active] += chunk;
+
+        t += chunk;
+    }
+
+    SwitchTo(ma, (now - 1) / 60);
+
+    size_t values[EMetric_Count];
+    ReadCounter(tick->counter, values);
+
+    for (int i = EMetric_Active + 1; i < EMetric_Count; i++) {
+        ma->current.values[i] += values[i] - ma->last[i];
+        ma->last[i] = values[i];
+    }
+}
@@ -0,0 +1,76 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "common.h"
+
+typedef enum EMetric {
+    EMetric_Active,
+    EMetric_Left,
+    EMetric_Middle,
+    EMetric_Right,
+    EMetric_Fourth,
+    EMetric_Fifth,
+    EMetric_Pixels,
+    EMetric_Keys,
+    EMetric_Count // KEEP LAST
+} EMetric;
+
+typedef struct MinuteRecord
+{
+    uint32 minute; // Minutes since 1.1.1970, local time
+    uint32 values[EMetric_Count];
+} MinuteRecord;
+
+typedef void (*MinuteObserver)(const MinuteRecord* record, void* userData);
+
+#define MAX_MINUTE_OBSERVERS 8
+
+// Splits statistics ticks into per-minute records. A record is passed to
+// the observers once its minute has closed, and only if it has any
+// activity.
+typedef struct MinuteAggregator
+{
+    const int64* timeOffset; // Stats clock to local time, may change
+    BOOL started;
+    MinuteRecord current;
+    size_t last[EMetric_Count];
+    size_t observerCount;
+    struct {
+        MinuteObserver observer;
+        void* userData;
+    } observers[MAX_MINUTE_OBSERVERS];
+} MinuteAggregator;
+
+extern MinuteAggregator minuteAggregator;
+
+extern const char* const metricNames[EMetric_Count];
+
+void MinutesInit(MinuteAggregator* ma, const int64* timeOffset, const Counter* counter);
+BOOL MinutesAddObserver(MinuteAggregator* ma, MinuteObserver observer, void* userData);
+void MinutesOnTick(const StatsTick* tick, void* userData);
+void MinutesFlush(MinuteAggregator* ma);
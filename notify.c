@@ -0,0 +1,105 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "notify.h"
+#include "logger.h"
+#include "version.h"
+
+#include <proto/exec.h>
+#include <proto/intuition.h>
+#include <proto/application.h>
+
+// Non-blocking notifications through application.library (Ringhio). If
+// that isn't available, fall back to a screen flash.
+
+static struct Library* appLibBase;
+static struct ApplicationIFace* appIFace;
+static uint32 appID;
+
+BOOL NotifyInit()
+{
+    appLibBase = IExec->OpenLibrary("application.library", 53);
+
+    if (!appLibBase) {
+        Log("Failed to open application.library");
+        return FALSE;
+    }
+
+    appIFace = (struct ApplicationIFace *)IExec->GetInterface(appLibBase, "application", 2, NULL);
+
+    if (!appIFace) {
+        Log("Failed to get application interface");
+        NotifyQuit();
+        return FALSE;
+    }
+
+    appID = appIFace->RegisterApplication(NAME_STRING,
+        REGAPP_URLIdentifier, "amigaos.net",
+        REGAPP_Description, "Mouse and keyboard activity meter",
+        REGAPP_NoIcon, TRUE,
+        TAG_DONE);
+
+    if (!appID) {
+        Log("Failed to register application");
+        NotifyQuit();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void NotifyQuit()
+{
+    if (appID) {
+        appIFace->UnregisterApplication(appID, TAG_DONE);
+        appID = 0;
+    }
+
+    if (appIFace) {
+        IExec->DropInterface((struct Interface *)appIFace);
+        appIFace = NULL;
+    }
+
+    if (appLibBase) {
+        IExec->CloseLibrary(appLibBase);
+        appLibBase = NULL;
+    }
+}
+
+void NotifyShow(const char* const title, const char* const text)
+{
+    Log("%s: %s", title, text);
+
+    if (appID) {
+        appIFace->Notify(appID,
+            APPNOTIFY_Title, title,
+            APPNOTIFY_Text, text,
+            APPNOTIFY_PubScreenName, "FRONT",
+            TAG_DONE);
+    } else {
+        IIntuition->DisplayBeep(NULL);
+    }
+}
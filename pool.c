@@ -0,0 +1,242 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "pool.h"
+
+#include <string.h>
+
+#ifdef __amigaos4__
+#include <proto/exec.h>
+#else
+#include <stdlib.h>
+
+// Host arena: slabs are carved from large blocks, which are only freed
+// all together
+#define ARENA_BLOCK_SLABS 4
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock* next;
+    size_t used;
+} ArenaBlock;
+
+// Keeps the slabs aligned after the header
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + 15) & ~(size_t)15)
+
+static ArenaBlock* NewBlock(ArenaBlock* next)
+{
+    ArenaBlock* block = malloc(ARENA_HEADER_SIZE + ARENA_BLOCK_SLABS * POOL_SLAB_SIZE);
+
+    if (block) {
+        block->next = next;
+        block->used = 0;
+    }
+
+    return block;
+}
+#endif
+
+static const size_t classSizes[POOL_CLASSES] = { 64, 256, 1024, POOL_MAX_OBJECT };
+
+Pool pool;
+
+static APTR CreateBacking(void)
+{
+#ifdef __amigaos4__
+    return IExec->AllocSysObjectTags(ASOT_MEMPOOL,
+        ASOPOOL_MFlags, MEMF_PRIVATE,
+        ASOPOOL_Puddle, 4 * POOL_SLAB_SIZE,
+        ASOPOOL_Threshold, POOL_SLAB_SIZE,
+        TAG_DONE);
+#else
+    return NewBlock(NULL);
+#endif
+}
+
+static void DeleteBacking(APTR handle)
+{
+#ifdef __amigaos4__
+    IExec->FreeSysObject(ASOT_MEMPOOL, handle);
+#else
+    ArenaBlock* block = (ArenaBlock *)handle;
+
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+#endif
+}
+
+static void* AllocSlab(APTR handle)
+{
+#ifdef __amigaos4__
+    return IExec->AllocPooled(handle, POOL_SLAB_SIZE);
+#else
+    // The newest block follows the first one
+    ArenaBlock* first = (ArenaBlock *)handle;
+    ArenaBlock* current = first->next ? first->next : first;
+
+    if (current->used == ARENA_BLOCK_SLABS) {
+        if (!(current = NewBlock(first->next))) {
+            return NULL;
+        }
+
+        first->next = current;
+    }
+
+    return (uint8 *)current + ARENA_HEADER_SIZE + current->used++ * POOL_SLAB_SIZE;
+#endif
+}
+
+BOOL PoolInit(Pool* p, size_t cap)
+{
+    memset(p, 0, sizeof(*p));
+
+    p->cap = cap;
+    p->handle = CreateBacking();
+
+    for (int i = 0; i < POOL_CLASSES; i++) {
+        p->classes[i].size = classSizes[i];
+    }
+
+    return p->handle != NULL;
+}
+
+void PoolQuit(Pool* p)
+{
+    if (p->handle) {
+        DeleteBacking(p->handle);
+        p->handle = NULL;
+    }
+}
+
+BOOL PoolAddEvictor(Pool* p, PoolEvictor evictor, void* userData)
+{
+    if (p->evictorCount >= POOL_MAX_EVICTORS) {
+        return FALSE;
+    }
+
+    p->evictors[p->evictorCount].evictor = evictor;
+    p->evictors[p->evictorCount].userData = userData;
+    p->evictorCount++;
+
+    return TRUE;
+}
+
+static PoolClass* ClassFor(Pool* p, size_t size)
+{
+    for (int i = 0; i < POOL_CLASSES; i++) {
+        if (size <= p->classes[i].size) {
+            return &p->classes[i];
+        }
+    }
+
+    return NULL;
+}
+
+static BOOL Grow(Pool* p, PoolClass* c)
+{
+    if (!p->handle || p->stats.reserved + POOL_SLAB_SIZE > p->cap) {
+        return FALSE;
+    }
+
+    uint8* slab = AllocSlab(p->handle);
+
+    if (!slab) {
+        return FALSE;
+    }
+
+    for (size_t offset = 0; offset + c->size <= POOL_SLAB_SIZE; offset += c->size) {
+        PoolObject* o = (PoolObject *)(slab + offset);
+        o->next = c->free;
+        c->free = o;
+    }
+
+    c->slabs++;
+    p->stats.reserved += POOL_SLAB_SIZE;
+
+    return TRUE;
+}
+
+// Evictors free whole objects, which may land in another class
+static void Evict(Pool* p, PoolClass* c)
+{
+    for (size_t i = 0; i < p->evictorCount && !c->free; i++) {
+        if (p->evictors[i].evictor(c->size, p->evictors[i].userData)) {
+            p->stats.evictions++;
+        }
+    }
+}
+
+void* PoolAlloc(Pool* p, size_t size)
+{
+    PoolClass* c = ClassFor(p, size);
+
+    if (!c) {
+        p->stats.failures++;
+        return NULL;
+    }
+
+    if (!c->free && !Grow(p, c)) {
+        Evict(p, c);
+    }
+
+    PoolObject* o = c->free;
+
+    if (!o) {
+        p->stats.failures++;
+        return NULL;
+    }
+
+    c->free = o->next;
+    c->used++;
+
+    p->stats.allocations++;
+    p->stats.used += c->size;
+
+    if (p->stats.used > p->stats.peak) {
+        p->stats.peak = p->stats.used;
+    }
+
+    return o;
+}
+
+void PoolFree(Pool* p, void* object, size_t size)
+{
+    PoolClass* c = ClassFor(p, size);
+
+    if (!object || !c) {
+        return;
+    }
+
+    PoolObject* o = (PoolObject *)object;
+    o->next = c->free;
+    c->free = o;
+    c->used--;
+
+    p->stats.used -= c->size;
+}
@@ -0,0 +1,90 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "platform.h"
+
+#include <stddef.h>
+
+// Fixed size slab classes on top of an exec memory pool, or a plain arena
+// on a host. Slabs are taken from the pool up to a hard cap and never given
+// back, so freed objects only return to their class. When the cap is
+// reached, the evictors are asked to free objects before an allocation
+// fails.
+
+#define POOL_CLASSES 4
+#define POOL_SLAB_SIZE 16384
+#define POOL_MAX_OBJECT 4096
+#define POOL_MAX_EVICTORS 4
+
+// Returns the number of bytes freed, 'wanted' is a hint
+typedef size_t (*PoolEvictor)(size_t wanted, void* userData);
+
+typedef struct PoolObject
+{
+    struct PoolObject* next;
+} PoolObject;
+
+typedef struct PoolClass
+{
+    size_t size;
+    size_t slabs;
+    size_t used; // Objects
+    PoolObject* free;
+} PoolClass;
+
+typedef struct PoolStats
+{
+    size_t reserved; // Bytes in slabs
+    size_t used; // Bytes in live objects
+    size_t peak;
+    size_t allocations;
+    size_t failures;
+    size_t evictions;
+} PoolStats;
+
+typedef struct Pool
+{
+    APTR handle;
+    size_t cap;
+    PoolStats stats;
+    PoolClass classes[POOL_CLASSES];
+    size_t evictorCount;
+    struct {
+        PoolEvictor evictor;
+        void* userData;
+    } evictors[POOL_MAX_EVICTORS];
+} Pool;
+
+extern Pool pool;
+
+BOOL PoolInit(Pool* p, size_t cap);
+void PoolQuit(Pool* p);
+BOOL PoolAddEvictor(Pool* p, PoolEvictor evictor, void* userData);
+
+void* PoolAlloc(Pool* p, size_t size);
+void PoolFree(Pool* p, void* object, size_t size);
@@ -0,0 +1,71 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "publish.h"
+#include "rollup.h"
+
+static const int64* offset;
+
+void PublishInit(ActivitySnapshot* snapshot, const int64* timeOffset)
+{
+    offset = timeOffset;
+
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    snapshot->version = SNAPSHOT_VERSION;
+    snapshot->size = sizeof(*snapshot);
+}
+
+void PublishOnTick(const StatsTick* tick, void* userData)
+{
+    ActivitySnapshot* s = (ActivitySnapshot *)userData;
+    const Counter* c = tick->counter;
+    const Rollup* today = RollupsGet(&rollups, EPeriod_Day, 0);
+    StatsSummary summary;
+
+    StatsGetSummary(&summary);
+
+    s->sequence++;
+    SNAPSHOT_BARRIER();
+
+    s->time = (uint32)(tick->now + *offset);
+    s->activeTotal = summary.activeSecondsTotal;
+    s->currentActivity = tick->activeSeconds;
+    s->currentBreak = tick->breakSeconds;
+    s->breaks = summary.breaks;
+    s->todayActive = today->values[EMetric_Active];
+    s->todayKeys = today->values[EMetric_Keys];
+    s->left = c->left;
+    s->middle = c->middle;
+    s->right = c->right;
+    s->fourth = c->fourth;
+    s->fifth = c->fifth;
+    s->keys = c->keys;
+    s->pixels = c->pixels;
+
+    SNAPSHOT_BARRIER();
+    s->sequence++;
+}
@@ -0,0 +1,179 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "reminder.h"
+
+#include <string.h>
+
+// Activity inside the sliding window is kept as per-minute buckets of
+// active seconds with a running sum. Deadlines are computed assuming that
+// activity continues, so the caller only needs to wake up when a reminder
+// could actually be due.
+
+void ReminderInit(Reminder* r, const ReminderConfig* config)
+{
+    memset(r, 0, sizeof(*r));
+
+    r->config = *config;
+
+    if (r->config.longBreakWindow > REMINDER_MAX_WINDOW) {
+        r->config.longBreakWindow = REMINDER_MAX_WINDOW;
+    }
+
+    if (r->config.longBreakWindow == 0 || r->config.longBreakAfter > r->config.longBreakWindow) {
+        r->config.longBreakAfter = 0;
+    }
+}
+
+static void AdvanceWindow(Reminder* r, size_t minute)
+{
+    const size_t window = r->config.longBreakWindow;
+
+    if (!r->started) {
+        r->minute = minute;
+        r->started = TRUE;
+        return;
+    }
+
+    if (minute <= r->minute) {
+        return;
+    }
+
+    if (minute - r->minute >= window) {
+        memset(r->buckets, 0, sizeof(r->buckets));
+        r->windowActive = 0;
+        r->minute = minute;
+        return;
+    }
+
+    while (r->minute < minute) {
+        r->minute++;
+
+        uint16* bucket = &r->buckets[r->minute % window];
+
+        r->windowActive -= *bucket;
+        *bucket = 0;
+    }
+}
+
+static void AddActivity(Reminder* r, size_t from, size_t seconds)
+{
+    const size_t end = from + seconds;
+
+    while (from < end) {
+        const size_t minute = from / 60;
+        const size_t minuteEnd = (minute + 1) * 60;
+        const size_t chunk = (end < minuteEnd ? end : minuteEnd) - from;
+
+        AdvanceWindow(r, minute);
+
+        r->buckets[minute % r->config.longBreakWindow] += chunk;
+        r->windowActive += chunk;
+
+        from += chunk;
+    }
+}
+
+static size_t RepeatAfter(const Reminder* r)
+{
+    const size_t rest = r->config.longBreakWindow - r->config.longBreakAfter;
+
+    return (rest ? rest : r->config.longBreakWindow) * 60;
+}
+
+void ReminderOnTick(const StatsTick* tick, void* userData)
+{
+    Reminder* r = (Reminder *)userData;
+
+    r->activeSeconds = tick->activeSeconds;
+
+    if (r->activeSeconds == 0) {
+        r->microShown = FALSE;
+    }
+
+    if (r->config.longBreakAfter) {
+        AddActivity(r, tick->from, tick->active);
+        AdvanceWindow(r, tick->now / 60);
+
+        if (r->longShown) {
+            r->sinceLong += tick->active;
+        }
+
+        // Repeat an ignored long break reminder after the rest of the
+        // window's worth of activity
+        if (r->windowActive < r->config.longBreakAfter * 60 || r->sinceLong >= RepeatAfter(r)) {
+            r->longShown = FALSE;
+        }
+    }
+}
+
+static uint32 Remaining(size_t done, size_t needed)
+{
+    return done >= needed ? 0 : needed - done;
+}
+
+uint32 ReminderDelay(const Reminder* r)
+{
+    uint32 delay = REMINDER_NEVER;
+
+    if (r->config.microPauseAfter && !r->microShown) {
+        const uint32 micro = Remaining(r->activeSeconds, r->config.microPauseAfter * 60);
+
+        if (micro < delay) {
+            delay = micro;
+        }
+    }
+
+    if (r->config.longBreakAfter) {
+        const uint32 longBreak = r->longShown ?
+            Remaining(r->sinceLong, RepeatAfter(r)) :
+            Remaining(r->windowActive, r->config.longBreakAfter * 60);
+
+        if (longBreak < delay) {
+            delay = longBreak;
+        }
+    }
+
+    return delay;
+}
+
+EReminder ReminderCheck(Reminder* r)
+{
+    if (r->config.longBreakAfter && !r->longShown && r->windowActive >= r->config.longBreakAfter * 60) {
+        r->longShown = TRUE;
+        r->sinceLong = 0;
+        // A long break covers the micro-pause too
+        r->microShown = TRUE;
+        return EReminder_LongBreak;
+    }
+
+    if (r->config.microPauseAfter && !r->microShown && r->activeSeconds >= r->config.microPauseAfter * 60) {
+        r->microShown = TRUE;
+        return EReminder_MicroPause;
+    }
+
+    return EReminder_None;
+}
@@ -0,0 +1,64 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "common.h"
+
+#define REMINDER_MAX_WINDOW 240
+#define REMINDER_NEVER 0xFFFFFFFF
+
+typedef struct ReminderConfig
+{
+    uint32 microPauseAfter; // Minutes of continuous activity, 0 disables
+    uint32 longBreakAfter; // Minutes of activity inside the window, 0 disables
+    uint32 longBreakWindow; // Minutes
+} ReminderConfig;
+
+typedef enum EReminder {
+    EReminder_None,
+    EReminder_MicroPause,
+    EReminder_LongBreak
+} EReminder;
+
+typedef struct Reminder
+{
+    ReminderConfig config;
+    size_t minute;
+    size_t windowActive;
+    size_t activeSeconds;
+    size_t sinceLong;
+    BOOL started;
+    BOOL microShown;
+    BOOL longShown;
+    uint16 buckets[REMINDER_MAX_WINDOW];
+} Reminder;
+
+void ReminderInit(Reminder* r, const ReminderConfig* config);
+void ReminderOnTick(const StatsTick* tick, void* userData);
+
+uint32 ReminderDelay(const Reminder* r);
+EReminder ReminderCheck(Reminder* r);
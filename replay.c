@@ -0,0 +1,1262 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Replays a recorded input journal through the input handler and the
+// statistics engine as fast as possible, or at a chosen speed factor.
+
+#include "common.h"
+#include "journal.h"
+#include "sessions.h"
+#include "minuteindex.h"
+#include "rollup.h"
+#include "calendar.h"
+#include "history.h"
+#include "publish.h"
+#include "command.h"
+#include "metrics.h"
+#include "apps.h"
+#include "pool.h"
+#include "reminder.h"
+#include "timerqueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPLAY_BATCH 64
+#define REPLAY_MAX_COMMANDS 16
+
+// Journal timestamps are Amiga system time, which counts from 1.1.1978
+static const int64 amigaEpochOffset = 252460800;
+
+typedef struct Replay
+{
+    Counter counter;
+    Clock clock;
+    struct InputEvent events[REPLAY_BATCH];
+    size_t batched;
+    size_t dispatched;
+    uint32 tick;
+    uint32 firstTick;
+    double speed;
+    struct timespec started;
+    BOOL sleep; // Step like the iconified meter
+    BOOL sleeping;
+    uint32 nextRefresh;
+    size_t sleeps;
+    size_t wakes;
+} Replay;
+
+static double Elapsed(const struct timespec* since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+static void SleepyRefresh(Replay* r);
+
+static void Dispatch(Replay* r)
+{
+    if (!r->batched) {
+        return;
+    }
+
+    for (size_t i = 0; i < r->batched; i++) {
+        r->events[i].ie_NextEvent = (i + 1 < r->batched) ? &r->events[i + 1] : NULL;
+    }
+
+    InputEventHandler(r->events, &r->counter);
+
+    r->dispatched += r->batched;
+    r->batched = 0;
+
+    // The handler cleared the wake signal: woken up within this second
+    if (r->sleeping && !r->counter.wakeSignal) {
+        r->wakes++;
+        SleepyRefresh(r);
+    }
+}
+
+static void Pace(const Replay* r)
+{
+    const double due = (r->tick - r->firstTick) / r->speed;
+    const double ahead = due - Elapsed(&r->started);
+
+    if (ahead > 0.001) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)ahead;
+        ts.tv_nsec = (long)((ahead - ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void Tick(Replay* r, uint32 seconds)
+{
+    r->tick = seconds;
+
+    VirtualClockSet(&r->clock, (uint64)seconds * 1000000);
+    CalculateStats();
+
+    if (r->speed > 0) {
+        Pace(r);
+    }
+}
+
+// With -sleep, the stats are stepped like in the iconified meter: a refresh
+// every second while awake, once a minute while asleep, and right away when
+// the input handler signals
+static void SleepyRefresh(Replay* r)
+{
+    CalculateStats();
+
+    const BOOL sleeping = StatsSleep(r, 1);
+
+    r->sleeps += sleeping && !r->sleeping;
+    r->sleeping = sleeping;
+    r->nextRefresh = r->tick + (r->sleeping ? 60 : 1);
+}
+
+static void AdvanceSleepy(Replay* r, uint32 seconds)
+{
+    Dispatch(r);
+
+    while (r->nextRefresh <= seconds) {
+        r->tick = r->nextRefresh;
+        VirtualClockSet(&r->clock, (uint64)r->tick * 1000000);
+        SleepyRefresh(r);
+    }
+
+    r->tick = seconds;
+    VirtualClockSet(&r->clock, (uint64)seconds * 1000000);
+}
+
+// Events are dispatched before the next one second tick, like the live
+// meter does. Idle gaps after that are covered by a single stats step
+// unless the replay is paced.
+static void AdvanceTo(Replay* r, uint32 seconds)
+{
+    if (r->tick >= seconds) {
+        return;
+    }
+
+    if (r->sleep) {
+        AdvanceSleepy(r, seconds);
+        return;
+    }
+
+    Dispatch(r);
+    Tick(r, r->tick + 1);
+
+    if (r->speed > 0) {
+        while (r->tick < seconds) {
+            Tick(r, r->tick + 1);
+        }
+    } else if (r->tick < seconds) {
+        Tick(r, seconds);
+    }
+}
+
+static void PrintStats(const Replay* r, double elapsed)
+{
+    const uint32 simulated = r->tick - r->firstTick;
+
+    puts(AllActivityString());
+    puts(CurrentActivityString());
+    puts(BreakString());
+    puts(TotalBreaksString());
+    puts(MouseCounterString());
+    puts(PixelsString());
+    puts(KeyCounterString());
+
+    SessionTotals totals;
+    SessionIndexQuery(&sessionIndex, r->firstTick + amigaEpochOffset, r->tick + amigaEpochOffset, &totals);
+
+    puts(TodayString());
+    puts(YesterdayString());
+    puts(DailyAverageString());
+
+    printf("Keys in the last hour: %llu\n", (unsigned long long)MinuteIndexSum(&minuteIndex, EMetric_Keys,
+        minuteIndex.newest - 59, minuteIndex.newest + 1));
+
+    printf("Sessions: %zu (%zu stored, %zu merged), active %zu seconds, %zu breaks, %zu keys, %zu clicks\n",
+        totals.sessions, sessionIndex.count, sessionIndex.merges, totals.active, totals.breaks, totals.keys, totals.clicks);
+
+    // Ranges meeting at a session start must add up to the whole
+    if (sessionIndex.count > 1) {
+        const uint32 split = SessionAt(&sessionIndex, sessionIndex.count / 2)->start;
+        SessionTotals before;
+        SessionTotals after;
+
+        SessionIndexQuery(&sessionIndex, r->firstTick + amigaEpochOffset, split, &before);
+        SessionIndexQuery(&sessionIndex, split, r->tick + amigaEpochOffset, &after);
+
+        const BOOL ok = before.sessions + after.sessions == totals.sessions &&
+            before.active + after.active == totals.active && before.breaks + after.breaks == totals.breaks &&
+            before.keys + after.keys == totals.keys && before.clicks + after.clicks == totals.clicks;
+
+        printf("Sessions split at session %zu: %zu + %zu breaks: %s\n", sessionIndex.count / 2, before.breaks,
+            after.breaks, ok ? "ok" : "MISMATCH");
+    }
+
+    for (int s = 0; s < EPointerSource_Count; s++) {
+        if (r->counter.pointers[s].events) {
+            printf("Pointer %s: %zu events, %zu pixels\n", pointerSourceNames[s], r->counter.pointers[s].events,
+                r->counter.pointers[s].pixels);
+        }
+    }
+
+    if (r->sleep) {
+        printf("Slept %zu times, woken %zu times by input\n", r->sleeps, r->wakes);
+    }
+
+    const Gestures* g = &r->counter.gestures;
+
+    printf("Gestures: %zu clicks, %zu double-clicks, %zu drags over %zu pixels in %llu ms, %zu pixels moved freely\n",
+        g->clicks, g->doubleClicks, g->drags, g->dragPixels, (unsigned long long)(g->dragMicros / 1000),
+        g->movePixels);
+
+    printf("Memory pool: %zu of %zu KB reserved, %zu bytes used, peak %zu, %zu allocations, %zu evictions, "
+        "%zu failures\n", pool.stats.reserved / 1024, pool.cap / 1024, pool.stats.used, pool.stats.peak,
+        pool.stats.allocations, pool.stats.evictions, pool.stats.failures);
+
+    printf("Replayed %zu events covering %u seconds in %.3f seconds", r->dispatched, simulated, elapsed);
+
+    if (elapsed > 0) {
+        printf(" (%.0fx real time, %.0f events / second)", simulated / elapsed, r->dispatched / elapsed);
+    }
+
+    puts("");
+}
+
+// Stand-in for the ARexx port: commands from the command line, answered
+// after the replay
+typedef struct CommandQueue
+{
+    const char* lines[REPLAY_MAX_COMMANDS];
+    size_t count;
+    size_t next;
+} CommandQueue;
+
+static void* NextCommand(void* queue, const char** line)
+{
+    CommandQueue* q = (CommandQueue *)queue;
+
+    if (q->next >= q->count) {
+        return NULL;
+    }
+
+    *line = q->lines[q->next];
+
+    return &q->lines[q->next++];
+}
+
+static void ReplyCommand(void* queue, void* message, ECommandResult rc, const char* const result)
+{
+    (void)queue;
+
+    printf("%s -> %d %s\n", *(const char**)message, rc, result);
+}
+
+static const Replay* appsReplay;
+static uint32 appsCount;
+
+// Pretends that the focus moves to the next of the programs every minute
+static BOOL SampleReplayApplication(char* name, size_t size)
+{
+    snprintf(name, size, "App %u", (appsReplay->tick / 60) % appsCount + 1);
+    return TRUE;
+}
+
+static void PrintApps(void)
+{
+    const AppEntry* top[APPS_SHOWN];
+    const size_t count = AppsTop(&appTable, top, APPS_SHOWN);
+
+    printf("Applications: %zu tracked, %zu evicted\n", appTable.count, appTable.evictions);
+
+    for (size_t i = 0; i < count; i++) {
+        printf("  %s: %u seconds, %u keys, %u clicks, %llu pixels\n", top[i]->name, top[i]->activeSeconds,
+            top[i]->keys, top[i]->clicks, (unsigned long long)top[i]->pixels);
+    }
+}
+
+// Reference for the handler's integer square root, by bisection
+static uint32 RootFloor(uint64 n)
+{
+    uint64 low = 0;
+    uint64 high = 1ULL << 32;
+
+    while (high - low > 1) {
+        const uint64 mid = (low + high) / 2;
+
+        if (mid * mid <= n) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return (uint32)low;
+}
+
+typedef struct PointerExpectation
+{
+    uint64 pixels[EPointerSource_Count];
+    int x[EPointerSource_Count];
+    int y[EPointerSource_Count];
+    BOOL seen[EPointerSource_Count];
+    size_t left;
+    size_t right;
+} PointerExpectation;
+
+// Pen tip and side button presses and releases on absolute positions
+static uint16 PenButton(PointerExpectation* pe)
+{
+    static const uint16 codes[] = {
+        IECODE_NOBUTTON, IECODE_NOBUTTON, IECODE_LBUTTON, IECODE_LBUTTON | IECODE_UP_PREFIX,
+        IECODE_RBUTTON, IECODE_RBUTTON | IECODE_UP_PREFIX
+    };
+
+    const uint16 code = codes[rand() % (sizeof(codes) / sizeof(codes[0]))];
+
+    pe->left += code == IECODE_LBUTTON;
+    pe->right += code == IECODE_RBUTTON;
+
+    return code;
+}
+
+static void ExpectPosition(PointerExpectation* pe, EPointerSource source, int x, int y)
+{
+    if (pe->seen[source]) {
+        const int64 dx = x - pe->x[source];
+        const int64 dy = y - pe->y[source];
+        pe->pixels[source] += RootFloor(dx * dx + dy * dy);
+    }
+
+    pe->x[source] = x;
+    pe->y[source] = y;
+    pe->seen[source] = TRUE;
+}
+
+static BOOL ComparePointers(const char* const label, const Counter* c, const PointerExpectation* pe,
+    uint64 relative)
+{
+    uint64 total = relative;
+    BOOL ok = TRUE;
+
+    printf("%s:", label);
+
+    for (int s = 0; s < EPointerSource_Count; s++) {
+        printf(" %s %zu/%zu", pointerSourceNames[s], c->pointers[s].pixels, c->pointers[s].events);
+        ok = ok && c->pointers[s].pixels == pe->pixels[s];
+        total += pe->pixels[s];
+    }
+
+    ok = ok && c->pixels == total && c->left == pe->left && c->right == pe->right;
+    printf(", total %zu pixels, LMB %zu/%zu, RMB %zu/%zu: %s\n", c->pixels, c->left, pe->left, c->right,
+        pe->right, ok ? "ok" : "MISMATCH");
+
+    return ok;
+}
+
+// Mixes relative moves with absolute positions from every source on a
+// 1920x1080 screen, some with pen buttons, checks the distances and
+// buttons, then records the stream into a journal and replays it
+static BOOL PointerTest(uint32 count, const char* const path)
+{
+    static Counter counter;
+    static Counter replayed;
+    static JournalRing ring;
+    static JournalWriter writer;
+    static JournalReader reader;
+
+    struct IEPointerPixel pixel = { NULL, { 0, 0 } };
+    struct IEPointerTablet tablet = { { 4000, 3000 }, { 0, 0 }, 0 };
+    struct IENewTablet newTablet = { NULL, 0, 0, 0, 0, 0, 0, 100000, 80000, NULL };
+    PointerExpectation pe;
+    uint64 relative = 0;
+
+    memset(&pe, 0, sizeof(pe));
+
+    counter.screenWidth = 1920;
+    counter.screenHeight = 1080;
+    counter.ring = &ring;
+
+    if (!JournalWriterOpen(&writer, path)) {
+        return FALSE;
+    }
+
+    srand(1);
+
+    for (uint32 i = 0; i < count; i++) {
+        struct InputEvent e;
+
+        memset(&e, 0, sizeof(e));
+        e.ie_TimeStamp.Seconds = 1000 + i / 100;
+
+        switch (rand() % 5) {
+            case 0:
+                e.ie_Class = IECLASS_RAWMOUSE;
+                e.ie_Code = IECODE_NOBUTTON;
+                e.ie_X = rand() % 41 - 20;
+                e.ie_Y = rand() % 41 - 20;
+                relative += RootFloor(e.ie_X * e.ie_X + e.ie_Y * e.ie_Y);
+                break;
+            case 1:
+                e.ie_Class = IECLASS_POINTERPOS;
+                e.ie_Code = PenButton(&pe);
+                e.ie_X = rand() % 1920;
+                e.ie_Y = rand() % 1080;
+                ExpectPosition(&pe, EPointerSource_Position, e.ie_X, e.ie_Y);
+                break;
+            case 2:
+                e.ie_Class = IECLASS_NEWPOINTERPOS;
+                e.ie_SubClass = IESUBCLASS_PIXEL;
+                e.ie_Code = PenButton(&pe);
+                e.ie_EventAddress = &pixel;
+                pixel.iepp_Position.X = rand() % 1920;
+                pixel.iepp_Position.Y = rand() % 1080;
+                ExpectPosition(&pe, EPointerSource_Pixel, pixel.iepp_Position.X, pixel.iepp_Position.Y);
+                break;
+            case 3:
+                e.ie_Class = IECLASS_NEWPOINTERPOS;
+                e.ie_SubClass = IESUBCLASS_TABLET;
+                e.ie_Code = PenButton(&pe);
+                e.ie_EventAddress = &tablet;
+                tablet.iept_Value.X = rand() % 4001;
+                tablet.iept_Value.Y = rand() % 3001;
+                ExpectPosition(&pe, EPointerSource_Tablet, tablet.iept_Value.X * 1919 / 4000,
+                    tablet.iept_Value.Y * 1079 / 3000);
+                break;
+            case 4:
+                e.ie_Class = IECLASS_NEWPOINTERPOS;
+                e.ie_SubClass = IESUBCLASS_NEWTABLET;
+                e.ie_Code = PenButton(&pe);
+                e.ie_EventAddress = &newTablet;
+                newTablet.ient_TabletX = rand() % 100001;
+                newTablet.ient_TabletY = rand() % 80001;
+                ExpectPosition(&pe, EPointerSource_NewTablet, (uint64)newTablet.ient_TabletX * 1919 / 100000,
+                    (uint64)newTablet.ient_TabletY * 1079 / 80000);
+                break;
+        }
+
+        InputEventHandler(&e, &counter);
+
+        if ((i & 1023) == 1023) {
+            JournalWriterDrain(&writer, &ring);
+        }
+    }
+
+    JournalWriterDrain(&writer, &ring);
+    JournalWriterClose(&writer);
+
+    BOOL ok = ComparePointers("Live", &counter, &pe, relative);
+
+    if (!JournalReaderOpen(&reader, path)) {
+        return FALSE;
+    }
+
+    JournalEvent je;
+    struct InputEvent e;
+
+    while (JournalReaderNext(&reader, &je)) {
+        JournalEventToInputEvent(&je, &e);
+        InputEventHandler(&e, &replayed);
+    }
+
+    JournalReaderClose(&reader);
+
+    return ComparePointers("Replayed", &replayed, &pe, relative) && ok;
+}
+
+typedef struct GestureScript
+{
+    Counter* counter;
+    JournalRing* ring;
+    JournalWriter* writer;
+    uint64 time; // Microseconds
+} GestureScript;
+
+static void ScriptEvent(GestureScript* gs, uint16 code, int16 x, int16 y, uint32 after)
+{
+    struct InputEvent e;
+
+    memset(&e, 0, sizeof(e));
+    gs->time += after;
+
+    e.ie_Class = IECLASS_RAWMOUSE;
+    e.ie_Code = code;
+    e.ie_X = x;
+    e.ie_Y = y;
+    e.ie_TimeStamp.Seconds = gs->time / 1000000;
+    e.ie_TimeStamp.Microseconds = gs->time % 1000000;
+
+    InputEventHandler(&e, gs->counter);
+    JournalWriterDrain(gs->writer, gs->ring);
+}
+
+static void ScriptClick(GestureScript* gs)
+{
+    ScriptEvent(gs, IECODE_LBUTTON, 0, 0, 1000000);
+    ScriptEvent(gs, IECODE_NOBUTTON, 1, 1, 30000);
+    ScriptEvent(gs, IECODE_LBUTTON | IECODE_UP_PREFIX, 0, 0, 50000);
+}
+
+static BOOL CompareGestures(const char* const label, const Gestures* g, const Gestures* expected)
+{
+    const BOOL ok = g->clicks == expected->clicks && g->doubleClicks == expected->doubleClicks &&
+        g->drags == expected->drags && g->dragPixels == expected->dragPixels &&
+        g->dragMicros == expected->dragMicros && g->movePixels == expected->movePixels;
+
+    printf("%s: %zu clicks, %zu double-clicks, %zu drags over %zu pixels in %llu us, %zu pixels moved: %s\n",
+        label, g->clicks, g->doubleClicks, g->drags, g->dragPixels, (unsigned long long)g->dragMicros,
+        g->movePixels, ok ? "ok" : "MISMATCH");
+
+    return ok;
+}
+
+// Scripted clicks, double- and triple-clicks, chords, drags and free movement with known
+// totals, checked live and after a journal round trip
+static BOOL GestureTest(uint32 count, const char* const path)
+{
+    static Counter counter;
+    static Counter replayed;
+    static JournalRing ring;
+    static JournalWriter writer;
+    static JournalReader reader;
+
+    GestureScript gs = { &counter, &ring, &writer, 1000000000ULL };
+    Gestures expected;
+
+    memset(&expected, 0, sizeof(expected));
+    counter.ring = &ring;
+
+    if (!JournalWriterOpen(&writer, path)) {
+        return FALSE;
+    }
+
+    srand(1);
+
+    for (uint32 i = 0; i < count; i++) {
+        switch (rand() % 5) {
+            case 0:
+                ScriptClick(&gs);
+                expected.clicks++;
+                break;
+            case 1:
+                ScriptClick(&gs);
+                ScriptEvent(&gs, IECODE_LBUTTON, 0, 0, 200000);
+                ScriptEvent(&gs, IECODE_LBUTTON | IECODE_UP_PREFIX, 0, 0, 60000);
+                expected.clicks += 2;
+                expected.doubleClicks++;
+                break;
+            case 2: {
+                const uint32 steps = 1 + rand() % 20;
+                const uint16 button = rand() % 2 ? IECODE_LBUTTON : IECODE_RBUTTON;
+
+                ScriptEvent(&gs, button, 0, 0, 1000000);
+
+                for (uint32 s = 0; s < steps; s++) {
+                    ScriptEvent(&gs, IECODE_NOBUTTON, 6, -8, 10000);
+                }
+
+                ScriptEvent(&gs, button | IECODE_UP_PREFIX, 0, 0, 20000);
+                expected.drags++;
+                expected.dragPixels += 10 * steps;
+                expected.dragMicros += 10000 * steps + 20000;
+                break;
+            }
+            case 3: {
+                const uint32 steps = 1 + rand() % 20;
+
+                for (uint32 s = 0; s < steps; s++) {
+                    ScriptEvent(&gs, IECODE_NOBUTTON, -3, 4, 10000);
+                }
+
+                expected.movePixels += 5 * steps;
+                break;
+            }
+            case 4:
+                // A triple-click counts one double-click, a chord doesn't count
+                ScriptClick(&gs);
+                ScriptEvent(&gs, IECODE_LBUTTON, 0, 0, 150000);
+                ScriptEvent(&gs, IECODE_RBUTTON, 0, 0, 10000);
+                ScriptEvent(&gs, IECODE_RBUTTON | IECODE_UP_PREFIX, 0, 0, 10000);
+                ScriptEvent(&gs, IECODE_LBUTTON | IECODE_UP_PREFIX, 0, 0, 10000);
+                ScriptEvent(&gs, IECODE_LBUTTON, 0, 0, 150000);
+                ScriptEvent(&gs, IECODE_LBUTTON | IECODE_UP_PREFIX, 0, 0, 60000);
+                expected.clicks += 3;
+                expected.doubleClicks++;
+                break;
+        }
+    }
+
+    JournalWriterClose(&writer);
+
+    BOOL ok = CompareGestures("Live", &counter.gestures, &expected);
+
+    if (!JournalReaderOpen(&reader, path)) {
+        return FALSE;
+    }
+
+    JournalEvent je;
+    struct InputEvent e;
+
+    while (JournalReaderNext(&reader, &je)) {
+        JournalEventToInputEvent(&je, &e);
+        InputEventHandler(&e, &replayed);
+    }
+
+    JournalReaderClose(&reader);
+
+    return CompareGestures("Replayed", &replayed.gestures, &expected) && ok;
+}
+
+static size_t longStepActive;
+
+static void LongStepOnTick(const StatsTick* tick, void* userData)
+{
+    (void)userData;
+    longStepActive += tick->active;
+}
+
+// A minute of input, then one hour-long step with a click at its end, like
+// the main loop blocked in a modal requester. It must count the same as
+// stepping every second: the hour is a break, not activity.
+static BOOL LongStepTest(void)
+{
+    static Counter counter;
+    Clock clock;
+    StatsSummary summary;
+
+    VirtualClockInit(&clock, 1000000000ULL);
+    InitStats(&counter, &clock);
+    StatsAddObserver(LongStepOnTick, NULL);
+
+    for (int i = 0; i < 60; i++) {
+        counter.activity++;
+        VirtualClockAdvance(&clock, 1000000);
+        CalculateStats();
+    }
+
+    counter.activity++;
+    VirtualClockAdvance(&clock, 3600 * 1000000ULL);
+    CalculateStats();
+
+    for (int i = 0; i < 10; i++) {
+        VirtualClockAdvance(&clock, 1000000);
+        CalculateStats();
+    }
+
+    StatsGetSummary(&summary);
+
+    // 60 seconds of input and 4 after it, the click and 4 after that
+    const BOOL ok = longStepActive == 69 && summary.breaks == 1;
+
+    printf("Long step: %zu active seconds, %zu breaks: %s\n", longStepActive, summary.breaks, ok ? "ok" : "MISMATCH");
+
+    return ok;
+}
+
+// Writes 1000 minutes of history, restarts with the clock an hour earlier
+// and writes 1000 more. The minutes must stay in order through compaction,
+// with the overlapping hour added into the last minute before the restart.
+static BOOL RestartTest(const char* const basePath)
+{
+    const uint32 first = 28000000;
+    const uint32 count = 1000;
+    MinuteRecord record;
+    uint64 expectedKeys = 0;
+
+    memset(&record, 0, sizeof(record));
+
+    if (!HistoryCreate(&history, basePath)) {
+        return FALSE;
+    }
+
+    for (int run = 0; run < 2; run++) {
+        if (run && !HistoryInit(&history, basePath)) {
+            return FALSE;
+        }
+
+        const uint32 start = first + run * (count - 60);
+
+        for (uint32 m = start; m < start + count; m++) {
+            record.minute = m;
+            record.values[EMetric_Active] = 60;
+            record.values[EMetric_Keys] = m % 7 + 1;
+            expectedKeys += record.values[EMetric_Keys];
+            HistoryOnMinute(&record, &history);
+        }
+    }
+
+    const size_t combined = history.combined;
+
+    while (HistoryCompact(&history)) {
+    }
+
+    HistoryReader reader;
+
+    if (!HistoryReaderOpen(&reader, basePath)) {
+        return FALSE;
+    }
+
+    size_t records = 0;
+    size_t disordered = 0;
+    uint64 keys = 0;
+    uint32 previous = 0;
+
+    while (HistoryReaderNext(&reader, &record)) {
+        disordered += records && record.minute <= previous;
+        previous = record.minute;
+        keys += record.values[EMetric_Keys];
+        records++;
+    }
+
+    HistoryReaderClose(&reader);
+
+    const BOOL ok = records == 2 * count - 60 && combined == 60 && !disordered && keys == expectedKeys;
+
+    printf("Restart: %zu records, %zu combined, %zu out of order, %llu of %llu keys: %s\n", records, combined,
+        disordered, (unsigned long long)keys, (unsigned long long)expectedKeys, ok ? "ok" : "MISMATCH");
+
+    return ok;
+}
+
+// Reminder schedule on a virtual clock, driven the way the GUI does it:
+// a refresh every second and a reminder timer at the next possible due time
+
+#define REMINDER_SIM_MAX_FIRED 32
+
+typedef struct ActiveSpan
+{
+    uint32 from; // Seconds into the timeline
+    uint32 to;
+} ActiveSpan;
+
+typedef struct ExpectedReminder
+{
+    uint32 at;
+    EReminder kind;
+} ExpectedReminder;
+
+typedef struct ReminderSim
+{
+    Clock clock;
+    TimerQueue queue;
+    Reminder reminder;
+    uint64 start;
+    size_t fired;
+    ExpectedReminder log[REMINDER_SIM_MAX_FIRED];
+} ReminderSim;
+
+static ReminderSim reminderSim;
+
+static void ReminderSimTimer(void* userData);
+
+static void ReminderSimSchedule(ReminderSim* rs)
+{
+    const uint32 delay = ReminderDelay(&rs->reminder);
+
+    if (delay == REMINDER_NEVER) {
+        TimerQueueCancel(&rs->queue, ETimer_Reminder);
+    } else {
+        TimerQueueSchedule(&rs->queue, ETimer_Reminder, (uint64)delay * 1000000, 0, 1000000, ReminderSimTimer, rs);
+    }
+}
+
+static void ReminderSimTimer(void* userData)
+{
+    ReminderSim* rs = (ReminderSim *)userData;
+
+    CalculateStats();
+
+    const EReminder kind = ReminderCheck(&rs->reminder);
+
+    if (kind != EReminder_None && rs->fired < REMINDER_SIM_MAX_FIRED) {
+        rs->log[rs->fired].at = (ClockNow(&rs->clock) - rs->start) / 1000000;
+        rs->log[rs->fired].kind = kind;
+        rs->fired++;
+    }
+
+    ReminderSimSchedule(rs);
+}
+
+static void ReminderSimRefresh(void* userData)
+{
+    ReminderSim* rs = (ReminderSim *)userData;
+
+    CalculateStats();
+
+    if (!TimerQueueIsScheduled(&rs->queue, ETimer_Reminder)) {
+        ReminderSimSchedule(rs);
+    }
+}
+
+static BOOL SpanActive(const ActiveSpan* spans, size_t count, uint32 second)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (second >= spans[i].from && second < spans[i].to) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// Micro-pause after 30 minutes, long break after 50 of the last 60, with
+// input every second inside the active spans. The phases are separated by
+// two hours of rest, which clears every reminder state.
+static BOOL ReminderTest(void)
+{
+    static Counter counter;
+    static ActiveSpan spans[64];
+    size_t spanCount = 0;
+
+    const ReminderConfig config = { 30, 50, 60 };
+    const uint32 phaseB = 7000 + 7200;
+    const uint32 phaseC = phaseB + 3 * 3600 + 7200;
+    const uint32 end = phaseC + 3600;
+
+    // Continuous input: a micro-pause, then the long break, repeated after
+    // every 10 further minutes of ignoring it
+    spans[spanCount++] = (ActiveSpan){ 0, 7000 };
+
+    // 20 minutes on, 10 off: the quiet time resets both reminders
+    for (uint32 t = phaseB; t < phaseB + 3 * 3600; t += 1800) {
+        spans[spanCount++] = (ActiveSpan){ t, t + 1200 };
+    }
+
+    // 20 minutes on, 2 off: no micro-pause, but 50 active minutes of 60
+    for (uint32 t = phaseC; t < end; t += 1320) {
+        spans[spanCount++] = (ActiveSpan){ t, t + 1200 };
+    }
+
+    const ExpectedReminder expected[] = {
+        { 1800, EReminder_MicroPause },
+        { 3000, EReminder_LongBreak },
+        { 3600, EReminder_LongBreak },
+        { 4200, EReminder_LongBreak },
+        { 4800, EReminder_LongBreak },
+        { 5400, EReminder_LongBreak },
+        { 6000, EReminder_LongBreak },
+        { 6600, EReminder_LongBreak },
+        // Two 20 minute spans with their 4 passive seconds, then 592 seconds
+        { phaseC + 2640 + 592, EReminder_LongBreak }
+    };
+    const size_t expectedCount = sizeof(expected) / sizeof(expected[0]);
+
+    ReminderSim* rs = &reminderSim;
+
+    rs->start = 1000000000ULL;
+    VirtualClockInit(&rs->clock, rs->start);
+    TimerQueueInit(&rs->queue, &rs->clock);
+    InitStats(&counter, &rs->clock);
+    ReminderInit(&rs->reminder, &config);
+    StatsAddObserver(ReminderOnTick, &rs->reminder);
+
+    TimerQueueSchedule(&rs->queue, ETimer_Refresh, 1000000, 1000000, 100000, ReminderSimRefresh, rs);
+    ReminderSimSchedule(rs);
+
+    uint64 wakeup;
+
+    while (TimerQueueNextWakeup(&rs->queue, &wakeup) && wakeup < rs->start + (uint64)end * 1000000) {
+        if (SpanActive(spans, spanCount, (wakeup - rs->start) / 1000000)) {
+            counter.activity++;
+        }
+
+        VirtualClockSet(&rs->clock, wakeup);
+        TimerQueueRun(&rs->queue, wakeup);
+    }
+
+    BOOL ok = rs->fired == expectedCount;
+
+    for (size_t i = 0; i < rs->fired; i++) {
+        const ExpectedReminder* want = i < expectedCount ? &expected[i] : NULL;
+        const BOOL match = want && want->kind == rs->log[i].kind &&
+            rs->log[i].at + 3 >= want->at && rs->log[i].at <= want->at + 3;
+
+        printf("%s at %u s%s\n", rs->log[i].kind == EReminder_MicroPause ? "Micro-pause" : "Long break",
+            rs->log[i].at, match ? "" : " (unexpected)");
+
+        ok = ok && match;
+    }
+
+    printf("%zu reminders of %zu expected in %zu wakeups: %s\n", rs->fired, expectedCount, rs->queue.wakeups,
+        ok ? "ok" : "MISMATCH");
+
+    return ok;
+}
+
+static void Usage(const char* const name)
+{
+    printf("Usage: %s <journal> [-speed <factor>] [-history <base path>] [-metrics <file>]\n"
+        "       [-command <command>]... [-apps <programs>] [-memory <KB>] [-indexdays <days>] [-sleep]\n", name);
+    printf("       %s -synthetic <days>\n", name);
+    printf("       %s -formatbench <iterations>\n", name);
+    printf("       %s -pointers <events> <journal>\n", name);
+    printf("       %s -gestures <gestures> <journal>\n", name);
+    printf("       %s -longstep\n", name);
+    printf("       %s -reminders\n", name);
+    printf("       %s -restart <base path>\n", name);
+}
+
+#define SYNTHETIC_INDEX_DAYS 35
+
+// Feeds the minute index with generated office-hours activity and times
+// updates and typical report queries against it
+static void Synthetic(uint32 days)
+{
+    const uint32 first = 20000 * 24 * 60;
+    const uint32 minutes = days * 24 * 60;
+    const uint32 today = (first + minutes) / (24 * 60) * (24 * 60);
+    const uint32 window = today - SYNTHETIC_INDEX_DAYS * 24 * 60;
+    uint64 windowPixels = 0;
+
+    if (!MinuteIndexInit(&minuteIndex, SYNTHETIC_INDEX_DAYS)) {
+        return;
+    }
+    srand(1);
+
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    for (uint32 m = first; m < first + minutes; m++) {
+        const uint32 hour = (m / 60) % 24;
+
+        if (hour >= 8 && hour < 17) {
+            MinuteRecord record;
+
+            record.minute = m;
+            for (int i = 0; i < EMetric_Count; i++) {
+                record.values[i] = rand() % 60;
+            }
+            // Up to 16000 pixels per second from a fast mouse
+            record.values[EMetric_Pixels] = rand() % 1000000;
+
+            if (m >= window && m < today) {
+                windowPixels += record.values[EMetric_Pixels];
+            }
+
+            MinuteIndexAdd(&minuteIndex, &record);
+        }
+    }
+
+    const double updateTime = Elapsed(&started);
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    const int rounds = 10000;
+    uint64 keys = 0;
+    uint64 clicks = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        // Keys 09:00 - 12:30 for the last 30 days
+        for (uint32 d = 1; d <= 30; d++) {
+            const uint32 day = today - d * 24 * 60;
+            keys += MinuteIndexSum(&minuteIndex, EMetric_Keys, day + 9 * 60, day + 12 * 60 + 30);
+        }
+
+        // Left clicks in the last 7 days
+        clicks += MinuteIndexSum(&minuteIndex, EMetric_Left, today - 7 * 24 * 60, today);
+    }
+
+    const double queryTime = Elapsed(&started);
+
+    printf("%u days, %u minutes: %.1f ns per minute update\n", days, minutes, updateTime * 1e9 / minutes);
+    printf("%d report rounds of 31 range sums: %.1f ns per range sum (checksum %llu, %llu)\n",
+        rounds, queryTime * 1e9 / (rounds * 31), (unsigned long long)keys, (unsigned long long)clicks);
+
+    const uint64 pixels = MinuteIndexSum(&minuteIndex, EMetric_Pixels, window, today);
+
+    printf("Pixels in the last %u days: %llu of %llu: %s\n", SYNTHETIC_INDEX_DAYS, (unsigned long long)pixels,
+        (unsigned long long)windowPixels, pixels == windowPixels ? "ok" : "MISMATCH");
+}
+
+// The stat strings as they were built with snprintf, for comparison
+static void SnprintfStrings(const Counter* c, char buf[EStatsString_Count][96])
+{
+    StatsSummary s;
+    StatsGetSummary(&s);
+
+    snprintf(buf[0], 96, "All activity time: %zu min %zu secs", s.activeSecondsTotal / 60, s.activeSecondsTotal % 60);
+    snprintf(buf[1], 96, "Current activity time: %zu min %zu secs", s.activeSeconds / 60, s.activeSeconds % 60);
+    snprintf(buf[2], 96, "Break time: %zu min %zu secs", s.breakSeconds / 60, s.breakSeconds % 60);
+    snprintf(buf[3], 96, "Total breaks: %zu", s.breaks);
+    snprintf(buf[4], 96, "LMB: %zu, MMB: %zu, RMB: %zu, 4th: %zu, 5th: %zu",
+        c->left, c->middle, c->right, c->fourth, c->fifth);
+    snprintf(buf[5], 96, "Keys pressed: %zu", c->keys);
+    snprintf(buf[6], 96, "Pixels travelled: %zu", c->pixels);
+
+    if (!s.breakSeconds) {
+        snprintf(buf[7], 96, "Active %zu min", s.activeSeconds / 60);
+    } else if (s.breakSeconds < BREAK_LENGTH) {
+        snprintf(buf[7], 96, "Break %zu/%d min", s.breakSeconds / 60, BREAK_LENGTH / 60);
+    } else {
+        snprintf(buf[7], 96, "Break %zu min", s.breakSeconds / 60);
+    }
+}
+
+static const char* cachedStrings[EStatsString_Count];
+
+static void CachedStrings(void)
+{
+    cachedStrings[0] = AllActivityString();
+    cachedStrings[1] = CurrentActivityString();
+    cachedStrings[2] = BreakString();
+    cachedStrings[3] = TotalBreaksString();
+    cachedStrings[4] = MouseCounterString();
+    cachedStrings[5] = KeyCounterString();
+    cachedStrings[6] = PixelsString();
+    cachedStrings[7] = IconTitleString();
+}
+
+// One simulated second of typing, like the meter's refresh
+static void BenchStep(Counter* c, Clock* clock, uint32 i)
+{
+    c->keys += 3;
+    c->left += (i % 4 == 0);
+    c->pixels += 120;
+    c->activity += (i % 50 < 40);
+    VirtualClockAdvance(clock, 1000000);
+    CalculateStats();
+}
+
+// Times the stat strings through snprintf and through the format cache,
+// both with values changing every second and with nothing changing
+static void FormatBench(uint32 iterations)
+{
+    static Counter counter;
+    static char reference[EStatsString_Count][96];
+    Clock clock;
+    struct timespec started;
+    double elapsed[4];
+    size_t mismatches = 0;
+
+    VirtualClockInit(&clock, 1000000000);
+    InitStats(&counter, &clock);
+
+    for (int pass = 0; pass < 3; pass++) {
+        clock_gettime(CLOCK_MONOTONIC, &started);
+
+        for (uint32 i = 0; i < iterations; i++) {
+            BenchStep(&counter, &clock, i);
+
+            if (pass == 1) {
+                SnprintfStrings(&counter, reference);
+            } else if (pass == 2) {
+                CachedStrings();
+            }
+        }
+
+        elapsed[pass] = Elapsed(&started);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    for (uint32 i = 0; i < iterations; i++) {
+        CachedStrings();
+    }
+
+    elapsed[3] = Elapsed(&started);
+
+    for (uint32 i = 0; i < iterations && i < 100000; i++) {
+        BenchStep(&counter, &clock, i);
+        SnprintfStrings(&counter, reference);
+        CachedStrings();
+
+        for (int s = 0; s < EStatsString_Count; s++) {
+            mismatches += strcmp(reference[s], cachedStrings[s]) != 0;
+        }
+    }
+
+    printf("%u refreshes of %d strings, ns per refresh: snprintf %.1f, cached %.1f, cached unchanged %.1f\n",
+        iterations, EStatsString_Count, (elapsed[1] - elapsed[0]) * 1e9 / iterations,
+        (elapsed[2] - elapsed[0]) * 1e9 / iterations, elapsed[3] * 1e9 / iterations);
+    printf("%zu mismatching strings\n", mismatches);
+}
+
+int main(int argc, char* argv[])
+{
+    static Replay replay;
+    static JournalReader reader;
+    static ActivitySnapshot snapshot;
+    static CommandQueue commands;
+
+    const char* path = NULL;
+    const char* historyPath = NULL;
+    const char* metricsPath = NULL;
+    size_t memoryLimit = 1024;
+    uint32 indexDays = MINUTE_INDEX_DAYS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-speed") == 0 && i + 1 < argc) {
+            replay.speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-command") == 0 && i + 1 < argc && commands.count < REPLAY_MAX_COMMANDS) {
+            commands.lines[commands.count++] = argv[++i];
+        } else if (strcmp(argv[i], "-metrics") == 0 && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (strcmp(argv[i], "-history") == 0 && i + 1 < argc) {
+            historyPath = argv[++i];
+        } else if (strcmp(argv[i], "-sleep") == 0) {
+            replay.sleep = TRUE;
+        } else if (strcmp(argv[i], "-memory") == 0 && i + 1 < argc) {
+            memoryLimit = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-indexdays") == 0 && i + 1 < argc) {
+            indexDays = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-apps") == 0 && i + 1 < argc) {
+            appsCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-synthetic") == 0 && i + 1 < argc) {
+            Synthetic(atoi(argv[++i]));
+            return 0;
+        } else if (strcmp(argv[i], "-pointers") == 0 && i + 2 < argc) {
+            const uint32 events = atoi(argv[i + 1]);
+            return PointerTest(events, argv[i + 2]) ? 0 : 1;
+        } else if (strcmp(argv[i], "-gestures") == 0 && i + 2 < argc) {
+            const uint32 gestures = atoi(argv[i + 1]);
+            return GestureTest(gestures, argv[i + 2]) ? 0 : 1;
+        } else if (strcmp(argv[i], "-reminders") == 0) {
+            return ReminderTest() ? 0 : 1;
+        } else if (strcmp(argv[i], "-restart") == 0 && i + 1 < argc) {
+            return RestartTest(argv[i + 1]) ? 0 : 1;
+        } else if (strcmp(argv[i], "-longstep") == 0) {
+            return LongStepTest() ? 0 : 1;
+        } else if (strcmp(argv[i], "-formatbench") == 0 && i + 1 < argc) {
+            FormatBench(atoi(argv[++i]));
+            return 0;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!path) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (!JournalReaderOpen(&reader, path)) {
+        return 1;
+    }
+
+    JournalEvent je;
+    BOOL first = TRUE;
+
+    clock_gettime(CLOCK_MONOTONIC, &replay.started);
+
+    while (JournalReaderNext(&reader, &je)) {
+        if (first) {
+            replay.tick = replay.firstTick = je.seconds;
+            replay.nextRefresh = je.seconds + 1;
+            VirtualClockInit(&replay.clock, (uint64)je.seconds * 1000000);
+            InitStats(&replay.counter, &replay.clock);
+            PoolInit(&pool, memoryLimit * 1024);
+            SessionIndexInit(&sessionIndex, &pool, &amigaEpochOffset, &replay.counter);
+            StatsAddObserver(SessionIndexOnTick, &sessionIndex);
+            MinutesInit(&minuteAggregator, &amigaEpochOffset, &replay.counter);
+            StatsAddObserver(MinutesOnTick, &minuteAggregator);
+            MinuteIndexInit(&minuteIndex, indexDays);
+            MinutesAddObserver(&minuteAggregator, MinuteIndexOnMinute, &minuteIndex);
+            RollupsInit(&rollups);
+            RollupsAdvance(&rollups, (je.seconds + amigaEpochOffset) / SECONDS_PER_DAY);
+            MinutesAddObserver(&minuteAggregator, RollupsOnMinute, &rollups);
+            if (metricsPath) {
+                MetricsInit(metricsPath, &replay.counter, &replay.clock, &amigaEpochOffset, NULL);
+            }
+            CommandInit(&replay.counter, &replay.clock, &amigaEpochOffset, historyPath, NULL);
+            PublishInit(&snapshot, &amigaEpochOffset);
+            StatsAddObserver(PublishOnTick, &snapshot);
+            if (historyPath && HistoryInit(&history, historyPath)) {
+                MinutesAddObserver(&minuteAggregator, HistoryOnMinute, &history);
+            }
+            if (appsCount) {
+                appsReplay = &replay;
+                AppsInit(&appTable, SampleReplayApplication, &replay.counter);
+                StatsAddObserver(AppsOnTick, &appTable);
+                if (historyPath) {
+                    AppsLoad(&appTable, historyPath);
+                }
+            }
+            first = FALSE;
+        }
+
+        AdvanceTo(&replay, je.seconds);
+
+        JournalEventToInputEvent(&je, &replay.events[replay.batched++]);
+
+        if (replay.batched == REPLAY_BATCH) {
+            Dispatch(&replay);
+        }
+    }
+
+    JournalReaderClose(&reader);
+
+    if (first) {
+        puts("Journal is empty");
+        return 0;
+    }
+
+    AdvanceTo(&replay, replay.tick + 1);
+    MinutesFlush(&minuteAggregator);
+
+    PrintStats(&replay, Elapsed(&replay.started));
+
+    ActivitySnapshot copy;
+
+    if (SnapshotRead(&snapshot, &copy)) {
+        printf("Snapshot %u: active %u seconds, %u breaks, %llu keys, today %u seconds\n", copy.sequence,
+            copy.activeTotal, copy.breaks, (unsigned long long)copy.keys, copy.todayActive);
+    }
+
+    if (metricsPath) {
+        MetricsWrite();
+    }
+
+    CommandServiceQueue(&commands, NextCommand, ReplyCommand);
+
+    if (appsCount) {
+        PrintApps();
+
+        if (historyPath && !AppsSave(&appTable)) {
+            printf("Failed to save '%s'\n", appTable.path);
+        }
+    }
+
+    if (historyPath) {
+        while (HistoryCompact(&history)) {
+        }
+
+        printf("History: %zu minutes appended, %zu blocks compacted from %zu to %zu bytes\n",
+            history.appended, history.compactedBlocks, history.rawBytes, history.compactedBytes);
+    }
+
+    return 0;
+}
@@ -0,0 +1,668 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Summarises the minute histories of any number of machines. Worker threads
+// take one history at a time and stream it block by block, so memory use
+// doesn't depend on how much history there is.
+
+#include "history.h"
+#include "calendar.h"
+#include "export.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPORT_MAX_THREADS 32
+#define REPORT_DEFAULT_THREADS 4
+#define REPORT_TOP_DAYS 10
+#define REPORT_KEY_BUCKETS 1024
+#define REPORT_OUTPUT_CHUNK 16384
+
+typedef enum EFormat {
+    EFormat_Text,
+    EFormat_Csv,
+    EFormat_Json
+} EFormat;
+
+typedef struct DayRow
+{
+    const char* source;
+    uint32 day;
+    uint64 active;
+    uint64 keys;
+    uint64 clicks;
+    uint64 pixels;
+} DayRow;
+
+typedef struct Summary
+{
+    size_t sources;
+    size_t failed;
+    uint64 days;
+    uint64 minutes;
+    uint64 active;
+    uint64 keys;
+    uint64 clicks;
+    uint64 pixels;
+    uint64 keyHistogram[REPORT_KEY_BUCKETS]; // minutes by keys typed
+    uint64 dayHistogram[MINUTES_PER_DAY + 1]; // days by active minutes
+    DayRow top[REPORT_TOP_DAYS]; // by keys, descending
+    size_t topCount;
+} Summary;
+
+typedef struct Worker
+{
+    pthread_t thread;
+    HistoryReader reader;
+    Summary summary;
+    char output[REPORT_OUTPUT_CHUNK];
+    size_t outputLength;
+} Worker;
+
+typedef struct Report
+{
+    char* const* paths;
+    size_t count;
+    size_t next;
+    EFormat format;
+    BOOL days;
+    BOOL firstRow;
+    pthread_mutex_t lock;
+} Report;
+
+static Report report;
+
+static const char* const formatNames[] = { "text", "csv", "json" };
+
+static void FlushOutput(Worker* w)
+{
+    if (!w->outputLength) {
+        return;
+    }
+
+    pthread_mutex_lock(&report.lock);
+
+    // JSON rows start with a comma, except the very first one
+    size_t skip = 0;
+
+    if (report.format == EFormat_Json && report.firstRow) {
+        skip = 1;
+    }
+
+    report.firstRow = FALSE;
+
+    fwrite(w->output + skip, 1, w->outputLength - skip, stdout);
+
+    pthread_mutex_unlock(&report.lock);
+
+    w->outputLength = 0;
+}
+
+static void Output(Worker* w, const char* const fmt, ...) __attribute__ ((format (printf, 2, 3)));
+
+static void Output(Worker* w, const char* const fmt, ...)
+{
+    for (int attempt = 0; attempt < 2; attempt++) {
+        const size_t space = sizeof(w->output) - w->outputLength;
+        va_list ap;
+
+        va_start(ap, fmt);
+        const int len = vsnprintf(w->output + w->outputLength, space, fmt, ap);
+        va_end(ap);
+
+        if (len >= 0 && (size_t)len < space) {
+            w->outputLength += len;
+            return;
+        }
+
+        FlushOutput(w);
+    }
+}
+
+static const char* DateString(uint32 day, char* buffer, size_t size)
+{
+    const CalendarDate date = CalendarFromDay(day);
+
+    snprintf(buffer, size, "%04d-%02d-%02d", date.year, date.month, date.day);
+
+    return buffer;
+}
+
+static const char* DurationString(uint64 seconds, char* buffer, size_t size)
+{
+    snprintf(buffer, size, "%llu:%02u:%02u", (unsigned long long)(seconds / 3600),
+        (unsigned)(seconds / 60 % 60), (unsigned)(seconds % 60));
+
+    return buffer;
+}
+
+// Paths are the only free-form strings in the output
+static const char* QuoteString(const char* const string, EFormat format, char* buffer, size_t size)
+{
+    size_t len = 0;
+
+    if (format == EFormat_Text) {
+        snprintf(buffer, size, "%s", string);
+        return buffer;
+    }
+
+    buffer[len++] = '"';
+
+    for (const char* c = string; *c && len + 3 < size; c++) {
+        if (*c == '"') {
+            buffer[len++] = format == EFormat_Csv ? '"' : '\\';
+        } else if (*c == '\\' && format == EFormat_Json) {
+            buffer[len++] = '\\';
+        }
+
+        buffer[len++] = *c;
+    }
+
+    buffer[len++] = '"';
+    buffer[len] = '\0';
+
+    return buffer;
+}
+
+static void OutputDay(Worker* w, const DayRow* row)
+{
+    char source[HISTORY_PATH_LENGTH * 2];
+    char date[16];
+    char active[32];
+
+    QuoteString(row->source, report.format, source, sizeof(source));
+    DateString(row->day, date, sizeof(date));
+
+    switch (report.format) {
+        case EFormat_Text:
+            Output(w, "%-24s %s %10s %10llu %10llu %12llu\n", source, date,
+                DurationString(row->active, active, sizeof(active)), (unsigned long long)row->keys,
+                (unsigned long long)row->clicks, (unsigned long long)row->pixels);
+            break;
+        case EFormat_Csv:
+            Output(w, "%s,%s,%llu,%llu,%llu,%llu\n", source, date, (unsigned long long)row->active,
+                (unsigned long long)row->keys, (unsigned long long)row->clicks, (unsigned long long)row->pixels);
+            break;
+        case EFormat_Json:
+            Output(w, ",\n    { \"source\": %s, \"date\": \"%s\", \"active\": %llu, \"keys\": %llu, "
+                "\"clicks\": %llu, \"pixels\": %llu }", source, date, (unsigned long long)row->active,
+                (unsigned long long)row->keys, (unsigned long long)row->clicks, (unsigned long long)row->pixels);
+            break;
+    }
+}
+
+static void AddTopDay(Summary* s, const DayRow* row)
+{
+    size_t i = s->topCount < REPORT_TOP_DAYS ? s->topCount++ : REPORT_TOP_DAYS;
+
+    if (i == REPORT_TOP_DAYS) {
+        if (row->keys <= s->top[REPORT_TOP_DAYS - 1].keys) {
+            return;
+        }
+        i--;
+    }
+
+    while (i > 0 && s->top[i - 1].keys < row->keys) {
+        s->top[i] = s->top[i - 1];
+        i--;
+    }
+
+    s->top[i] = *row;
+}
+
+static void FinishDay(Worker* w, const DayRow* row)
+{
+    Summary* s = &w->summary;
+    const uint64 activeMinutes = row->active / 60;
+
+    s->days++;
+    s->dayHistogram[activeMinutes < MINUTES_PER_DAY ? activeMinutes : MINUTES_PER_DAY]++;
+
+    AddTopDay(s, row);
+
+    if (report.days) {
+        OutputDay(w, row);
+    }
+}
+
+static void Summarise(Worker* w, const char* const path)
+{
+    Summary* s = &w->summary;
+    MinuteRecord record;
+    DayRow row;
+    BOOL open = FALSE;
+
+    if (!HistoryReaderOpen(&w->reader, path)) {
+        fprintf(stderr, "No history found at '%s'\n", path);
+        s->failed++;
+        return;
+    }
+
+    s->sources++;
+
+    while (HistoryReaderNext(&w->reader, &record)) {
+        const uint32 day = record.minute / MINUTES_PER_DAY;
+        const uint32 clicks = record.values[EMetric_Left] + record.values[EMetric_Middle] +
+            record.values[EMetric_Right] + record.values[EMetric_Fourth] + record.values[EMetric_Fifth];
+        const uint32 keys = record.values[EMetric_Keys];
+
+        if (!open || day != row.day) {
+            if (open) {
+                FinishDay(w, &row);
+            }
+
+            memset(&row, 0, sizeof(row));
+            row.source = path;
+            row.day = day;
+            open = TRUE;
+        }
+
+        row.active += record.values[EMetric_Active];
+        row.keys += keys;
+        row.clicks += clicks;
+        row.pixels += record.values[EMetric_Pixels];
+
+        s->minutes++;
+        s->active += record.values[EMetric_Active];
+        s->keys += keys;
+        s->clicks += clicks;
+        s->pixels += record.values[EMetric_Pixels];
+        s->keyHistogram[keys < REPORT_KEY_BUCKETS ? keys : REPORT_KEY_BUCKETS - 1]++;
+    }
+
+    if (open) {
+        FinishDay(w, &row);
+    }
+
+    if (w->reader.damaged) {
+        fprintf(stderr, "Skipped %zu damaged blocks in '%s'\n", w->reader.damaged, path);
+    }
+
+    HistoryReaderClose(&w->reader);
+}
+
+static void* WorkerMain(void* userData)
+{
+    Worker* w = (Worker *)userData;
+
+    while (TRUE) {
+        pthread_mutex_lock(&report.lock);
+        const size_t next = report.next++;
+        pthread_mutex_unlock(&report.lock);
+
+        if (next >= report.count) {
+            break;
+        }
+
+        Summarise(w, report.paths[next]);
+    }
+
+    FlushOutput(w);
+
+    return NULL;
+}
+
+static void MergeSummary(Summary* total, const Summary* s)
+{
+    total->sources += s->sources;
+    total->failed += s->failed;
+    total->days += s->days;
+    total->minutes += s->minutes;
+    total->active += s->active;
+    total->keys += s->keys;
+    total->clicks += s->clicks;
+    total->pixels += s->pixels;
+
+    for (size_t i = 0; i < REPORT_KEY_BUCKETS; i++) {
+        total->keyHistogram[i] += s->keyHistogram[i];
+    }
+
+    for (size_t i = 0; i <= MINUTES_PER_DAY; i++) {
+        total->dayHistogram[i] += s->dayHistogram[i];
+    }
+
+    for (size_t i = 0; i < s->topCount; i++) {
+        AddTopDay(total, &s->top[i]);
+    }
+}
+
+// Smallest bucket that covers the given share of the samples
+static size_t Percentile(const uint64* histogram, size_t buckets, double share)
+{
+    uint64 samples = 0;
+
+    for (size_t i = 0; i < buckets; i++) {
+        samples += histogram[i];
+    }
+
+    const uint64 wanted = (uint64)(samples * share + 0.999999);
+    uint64 seen = 0;
+
+    for (size_t i = 0; i < buckets; i++) {
+        seen += histogram[i];
+
+        if (seen >= wanted && seen > 0) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+static const double percentiles[] = { 0.5, 0.9, 0.99 };
+static const char* const percentileNames[] = { "p50", "p90", "p99" };
+
+#define PERCENTILE_COUNT (sizeof(percentiles) / sizeof(percentiles[0]))
+
+static void PrintTextSummary(const Summary* s)
+{
+    char buffer[32];
+    char date[16];
+
+    printf("\nSources: %zu (%zu failed)\n", s->sources, s->failed);
+    printf("Days: %llu, minutes with activity: %llu\n", (unsigned long long)s->days, (unsigned long long)s->minutes);
+    printf("Active time: %s\n", DurationString(s->active, buffer, sizeof(buffer)));
+    printf("Keys: %llu, clicks: %llu, pixels: %llu\n", (unsigned long long)s->keys, (unsigned long long)s->clicks,
+        (unsigned long long)s->pixels);
+
+    printf("Active minutes per day:");
+    for (size_t p = 0; p < PERCENTILE_COUNT; p++) {
+        printf(" %s %zu", percentileNames[p], Percentile(s->dayHistogram, MINUTES_PER_DAY + 1, percentiles[p]));
+    }
+
+    printf("\nKeys per active minute:");
+    for (size_t p = 0; p < PERCENTILE_COUNT; p++) {
+        printf(" %s %zu", percentileNames[p], Percentile(s->keyHistogram, REPORT_KEY_BUCKETS, percentiles[p]));
+    }
+
+    puts("\nTop days by keys:");
+    for (size_t i = 0; i < s->topCount; i++) {
+        printf("%2zu. %-24s %s %10llu\n", i + 1, s->top[i].source, DateString(s->top[i].day, date, sizeof(date)),
+            (unsigned long long)s->top[i].keys);
+    }
+}
+
+static void PrintCsvSummary(const Summary* s)
+{
+    char source[HISTORY_PATH_LENGTH * 2];
+    char date[16];
+
+    printf("\nsummary,value\n");
+    printf("sources,%zu\nfailed,%zu\ndays,%llu\nminutes,%llu\n", s->sources, s->failed,
+        (unsigned long long)s->days, (unsigned long long)s->minutes);
+    printf("active,%llu\nkeys,%llu\nclicks,%llu\npixels,%llu\n", (unsigned long long)s->active,
+        (unsigned long long)s->keys, (unsigned long long)s->clicks, (unsigned long long)s->pixels);
+
+    for (size_t p = 0; p < PERCENTILE_COUNT; p++) {
+        printf("active_minutes_per_day_%s,%zu\n", percentileNames[p],
+            Percentile(s->dayHistogram, MINUTES_PER_DAY + 1, percentiles[p]));
+    }
+
+    for (size_t p = 0; p < PERCENTILE_COUNT; p++) {
+        printf("keys_per_minute_%s,%zu\n", percentileNames[p],
+            Percentile(s->keyHistogram, REPORT_KEY_BUCKETS, percentiles[p]));
+    }
+
+    printf("\nrank,source,date,keys\n");
+    for (size_t i = 0; i < s->topCount; i++) {
+        printf("%zu,%s,%s,%llu\n", i + 1, QuoteString(s->top[i].source, EFormat_Csv, source, sizeof(source)),
+            DateString(s->top[i].day, date, sizeof(date)), (unsigned long long)s->top[i].keys);
+    }
+}
+
+static void PrintJsonSummary(const Summary* s)
+{
+    char source[HISTORY_PATH_LENGTH * 2];
+    char date[16];
+
+    printf("\n  ],\n  \"totals\": { \"sources\": %zu, \"failed\": %zu, \"days\": %llu, \"minutes\": %llu, "
+        "\"active\": %llu, \"keys\": %llu, \"clicks\": %llu, \"pixels\": %llu },\n",
+        s->sources, s->failed, (unsigned long long)s->days, (unsigned long long)s->minutes,
+        (unsigned long long)s->active, (unsigned long long)s->keys, (unsigned long long)s->clicks,
+        (unsigned long long)s->pixels);
+
+    printf("  \"activeMinutesPerDay\": {");
+    for (size_t p = 0; p < PERCENTILE_COUNT; p++) {
+        printf("%s \"%s\": %zu", p ? "," : "", percentileNames[p],
+            Percentile(s->dayHistogram, MINUTES_PER_DAY + 1, percentiles[p]));
+    }
+
+    printf(" },\n  \"keysPerMinute\": {");
+    for (size_t p = 0; p < PERCENTILE_COUNT; p++) {
+        printf("%s \"%s\": %zu", p ? "," : "", percentileNames[p],
+            Percentile(s->keyHistogram, REPORT_KEY_BUCKETS, percentiles[p]));
+    }
+
+    printf(" },\n  \"topDays\": [");
+    for (size_t i = 0; i < s->topCount; i++) {
+        printf("%s\n    { \"source\": %s, \"date\": \"%s\", \"keys\": %llu }", i ? "," : "",
+            QuoteString(s->top[i].source, EFormat_Json, source, sizeof(source)),
+            DateString(s->top[i].day, date, sizeof(date)), (unsigned long long)s->top[i].keys);
+    }
+
+    puts("\n  ]\n}");
+}
+
+static void PrintHeader(void)
+{
+    switch (report.format) {
+        case EFormat_Text:
+            if (report.days) {
+                printf("%-24s %-10s %10s %10s %10s %12s\n", "Source", "Date", "Active", "Keys", "Clicks", "Pixels");
+            }
+            break;
+        case EFormat_Csv:
+            if (report.days) {
+                puts("source,date,active,keys,clicks,pixels");
+            }
+            break;
+        case EFormat_Json:
+            printf("{\n  \"days\": [");
+            break;
+    }
+
+    fflush(stdout);
+}
+
+static void Usage(const char* const name)
+{
+    printf("Usage: %s [-format text|csv|json] [-threads <n>] [-nodays] <history base path>...\n", name);
+    printf("       %s -export <file> [-format csv|json] [-from <yyyy-mm-dd>] [-to <yyyy-mm-dd>] <history base path>\n",
+        name);
+}
+
+static BOOL ParseDate(const char* const string, uint32* day)
+{
+    CalendarDate date;
+
+    if (sscanf(string, "%d-%d-%d", &date.year, &date.month, &date.day) != 3 || date.year < 1970 ||
+        date.month < 1 || date.month > 12 || date.day < 1 || date.day > 31) {
+        return FALSE;
+    }
+
+    *day = CalendarToDay(&date);
+
+    return TRUE;
+}
+
+// Minutes from the start of 'from' to the end of 'to'
+static int Export(const char* const outputPath, const char* const historyPath, EFormat format,
+    const char* const from, const char* const to)
+{
+    uint32 first = 0;
+    uint32 last = EXPORT_ALL_MINUTES;
+    uint32 day;
+
+    if (from) {
+        if (!ParseDate(from, &day)) {
+            printf("Invalid date '%s'\n", from);
+            return 1;
+        }
+        first = day * MINUTES_PER_DAY;
+    }
+
+    if (to) {
+        if (!ParseDate(to, &day)) {
+            printf("Invalid date '%s'\n", to);
+            return 1;
+        }
+        last = (day + 1) * MINUTES_PER_DAY;
+    }
+
+    const int32 records = ExportHistory(historyPath, outputPath,
+        format == EFormat_Json ? EExportFormat_Json : EExportFormat_Csv, first, last);
+
+    if (records < 0) {
+        return 1;
+    }
+
+    printf("Exported %d minutes to '%s'\n", records, outputPath);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t threads = REPORT_DEFAULT_THREADS;
+    const char* exportPath = NULL;
+    const char* from = NULL;
+    const char* to = NULL;
+    BOOL formatGiven = FALSE;
+    int first = 1;
+
+    report.format = EFormat_Text;
+    report.days = TRUE;
+    report.firstRow = TRUE;
+
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (strcmp(argv[first], "-format") == 0 && first + 1 < argc) {
+            const char* const name = argv[++first];
+            size_t f = 0;
+
+            while (f <= EFormat_Json && strcmp(name, formatNames[f]) != 0) {
+                f++;
+            }
+
+            if (f > EFormat_Json) {
+                Usage(argv[0]);
+                return 1;
+            }
+
+            report.format = (EFormat)f;
+            formatGiven = TRUE;
+        } else if (strcmp(argv[first], "-export") == 0 && first + 1 < argc) {
+            exportPath = argv[++first];
+        } else if (strcmp(argv[first], "-from") == 0 && first + 1 < argc) {
+            from = argv[++first];
+        } else if (strcmp(argv[first], "-to") == 0 && first + 1 < argc) {
+            to = argv[++first];
+        } else if (strcmp(argv[first], "-threads") == 0 && first + 1 < argc) {
+            threads = atoi(argv[++first]);
+        } else if (strcmp(argv[first], "-nodays") == 0) {
+            report.days = FALSE;
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (first >= argc || (exportPath && (first + 1 != argc || (report.format == EFormat_Text && formatGiven)))) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (exportPath) {
+        return Export(exportPath, argv[first], report.format, from, to);
+    }
+
+    report.paths = argv + first;
+    report.count = argc - first;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > REPORT_MAX_THREADS) {
+        threads = REPORT_MAX_THREADS;
+    }
+    if (threads > report.count) {
+        threads = report.count;
+    }
+
+    Worker* workers = calloc(threads, sizeof(Worker));
+
+    if (!workers) {
+        puts("Failed to allocate workers");
+        return 1;
+    }
+
+    pthread_mutex_init(&report.lock, NULL);
+
+    PrintHeader();
+
+    size_t started = 0;
+
+    for (; started < threads; started++) {
+        if (pthread_create(&workers[started].thread, NULL, WorkerMain, &workers[started]) != 0) {
+            break;
+        }
+    }
+
+    if (!started) {
+        // Do the work on this thread instead
+        WorkerMain(&workers[0]);
+        started = 1;
+    } else {
+        for (size_t i = 0; i < started; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+    }
+
+    static Summary total;
+
+    for (size_t i = 0; i < started; i++) {
+        MergeSummary(&total, &workers[i].summary);
+    }
+
+    switch (report.format) {
+        case EFormat_Text:
+            PrintTextSummary(&total);
+            break;
+        case EFormat_Csv:
+            PrintCsvSummary(&total);
+            break;
+        case EFormat_Json:
+            PrintJsonSummary(&total);
+            break;
+    }
+
+    pthread_mutex_destroy(&report.lock);
+    free(workers);
+
+    return total.sources ? 0 : 1;
+}
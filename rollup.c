@@ -0,0 +1,223 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "rollup.h"
+#include "calendar.h"
+#include "format.h"
+
+#include <string.h>
+
+Rollups rollups;
+
+static uint32 PeriodStart(EPeriod period, uint32 day)
+{
+    switch (period) {
+        case EPeriod_Week: return CalendarWeekStart(day);
+        case EPeriod_Month: return CalendarMonthStart(day);
+        default: return day;
+    }
+}
+
+static void AddRollup(Rollup* to, const Rollup* from, int sign)
+{
+    to->minutes += sign * from->minutes;
+
+    for (int i = 0; i < EMetric_Count; i++) {
+        to->values[i] += sign * from->values[i];
+    }
+}
+
+static void PushRecentDay(Rollups* r, const Rollup* day)
+{
+    Rollup* slot = &r->recentDays[r->recentCount % ROLLUP_AVERAGE_DAYS];
+
+    if (r->recentCount >= ROLLUP_AVERAGE_DAYS) {
+        AddRollup(&r->recentSum, slot, -1);
+    }
+
+    *slot = *day;
+    AddRollup(&r->recentSum, slot, 1);
+
+    r->recentCount++;
+}
+
+static void Archive(Rollups* r, EPeriod period, uint32 start)
+{
+    Rollup* current = &r->current[period];
+
+    r->archive[period][r->archived[period] % ROLLUP_HISTORY] = *current;
+    r->archived[period]++;
+
+    memset(current, 0, sizeof(*current));
+    current->first = start;
+}
+
+void RollupsInit(Rollups* r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+void RollupsAdvance(Rollups* r, uint32 day)
+{
+    if (!r->started) {
+        for (int p = 0; p < EPeriod_Count; p++) {
+            r->current[p].first = PeriodStart(p, day);
+        }
+
+        r->started = TRUE;
+        return;
+    }
+
+    if (day <= r->current[EPeriod_Day].first) {
+        return;
+    }
+
+    // Idle days still count towards the average
+    const uint32 today = r->current[EPeriod_Day].first;
+
+    PushRecentDay(r, &r->current[EPeriod_Day]);
+
+    for (uint32 d = today + 1; d < day && d < today + 1 + ROLLUP_AVERAGE_DAYS; d++) {
+        const Rollup idle = { d, 0, { 0 } };
+        PushRecentDay(r, &idle);
+    }
+
+    for (int p = 0; p < EPeriod_Count; p++) {
+        const uint32 start = PeriodStart(p, day);
+
+        if (start != r->current[p].first) {
+            Archive(r, p, start);
+        }
+    }
+}
+
+void RollupsOnMinute(const MinuteRecord* record, void* userData)
+{
+    Rollups* r = (Rollups *)userData;
+
+    RollupsAdvance(r, record->minute / MINUTES_PER_DAY);
+
+    for (int p = 0; p < EPeriod_Count; p++) {
+        Rollup* current = &r->current[p];
+
+        current->minutes++;
+
+        for (int i = 0; i < EMetric_Count; i++) {
+            current->values[i] += record->values[i];
+        }
+    }
+}
+
+const Rollup* RollupsGet(const Rollups* r, EPeriod period, size_t age)
+{
+    if (age == 0) {
+        return &r->current[period];
+    }
+
+    if (age > r->archived[period] || age > ROLLUP_HISTORY) {
+        return NULL;
+    }
+
+    return &r->archive[period][(r->archived[period] - age) % ROLLUP_HISTORY];
+}
+
+void RollupsDailyAverage(const Rollups* r, Rollup* average)
+{
+    const size_t days = r->recentCount < ROLLUP_AVERAGE_DAYS ? r->recentCount : ROLLUP_AVERAGE_DAYS;
+
+    memset(average, 0, sizeof(*average));
+
+    if (days) {
+        average->minutes = r->recentSum.minutes / days;
+
+        for (int i = 0; i < EMetric_Count; i++) {
+            average->values[i] = r->recentSum.values[i] / days;
+        }
+    }
+}
+
+static size_t Clicks(const Rollup* rollup)
+{
+    return rollup->values[EMetric_Left] + rollup->values[EMetric_Middle] + rollup->values[EMetric_Right] +
+        rollup->values[EMetric_Fourth] + rollup->values[EMetric_Fifth];
+}
+
+static char* FormatRollup(FormatCache* cache, const char* const label, size_t length, const Rollup* rollup)
+{
+    const uint64 keys[] = {
+        rollup != NULL,
+        rollup ? rollup->values[EMetric_Active] / 60 : 0,
+        rollup ? rollup->values[EMetric_Keys] : 0,
+        rollup ? Clicks(rollup) : 0
+    };
+
+    if (FormatCacheStale(cache, keys, 4)) {
+        FormatBuilder b;
+
+        FormatBegin(&b, cache->text, sizeof(cache->text));
+        FormatText(&b, label, length);
+
+        if (rollup) {
+            FormatText(&b, FORMAT_LABEL(": "));
+            FormatNumber(&b, keys[1]);
+            FormatText(&b, FORMAT_LABEL(" min active, "));
+            FormatNumber(&b, keys[2]);
+            FormatText(&b, FORMAT_LABEL(" keys, "));
+            FormatNumber(&b, keys[3]);
+            FormatText(&b, FORMAT_LABEL(" clicks"));
+        } else {
+            FormatText(&b, FORMAT_LABEL(": -"));
+        }
+
+        FormatEnd(&b);
+    }
+
+    return cache->text;
+}
+
+char* TodayString()
+{
+    static FormatCache cache;
+    return FormatRollup(&cache, FORMAT_LABEL("Today"), RollupsGet(&rollups, EPeriod_Day, 0));
+}
+
+char* YesterdayString()
+{
+    static FormatCache cache;
+    const Rollup* yesterday = RollupsGet(&rollups, EPeriod_Day, 1);
+
+    return FormatRollup(&cache, FORMAT_LABEL("Yesterday"),
+        yesterday && yesterday->first + 1 == rollups.current[EPeriod_Day].first ? yesterday : NULL);
+}
+
+char* DailyAverageString()
+{
+    static FormatCache cache;
+    Rollup average;
+
+    RollupsDailyAverage(&rollups, &average);
+    return FormatRollup(&cache, FORMAT_LABEL("7 day average"), rollups.recentCount ? &average : NULL);
+}
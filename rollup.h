@@ -0,0 +1,74 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "minutes.h"
+
+#define ROLLUP_HISTORY 8
+#define ROLLUP_AVERAGE_DAYS 7
+
+typedef enum EPeriod {
+    EPeriod_Day,
+    EPeriod_Week,
+    EPeriod_Month,
+    EPeriod_Count // KEEP LAST
+} EPeriod;
+
+typedef struct Rollup
+{
+    uint32 first; // Day number of the period start
+    uint32 minutes; // Minutes with any activity
+    uint64 values[EMetric_Count];
+} Rollup;
+
+// Calendar rollups updated as each minute closes. Finished periods are
+// archived, and a running sum over the last finished days gives the daily
+// average without rescanning.
+typedef struct Rollups
+{
+    BOOL started;
+    Rollup current[EPeriod_Count];
+    Rollup archive[EPeriod_Count][ROLLUP_HISTORY];
+    size_t archived[EPeriod_Count];
+    Rollup recentDays[ROLLUP_AVERAGE_DAYS];
+    Rollup recentSum;
+    size_t recentCount;
+} Rollups;
+
+extern Rollups rollups;
+
+void RollupsInit(Rollups* r);
+void RollupsAdvance(Rollups* r, uint32 day);
+void RollupsOnMinute(const MinuteRecord* record, void* userData);
+
+// 0 is the current period, 1 the previous one and so on
+const Rollup* RollupsGet(const Rollups* r, EPeriod period, size_t age);
+void RollupsDailyAverage(const Rollups* r, Rollup* average);
+
+char* TodayString();
+char* YesterdayString();
+char* DailyAverageString();
@@ -0,0 +1,306 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "sessions.h"
+
+#include <string.h>
+
+SessionIndex sessionIndex;
+
+static const Session none = { 0, 0, 0, 0, 0, 0, 0 };
+
+static size_t Clicks(const Counter* c)
+{
+    return c->left + c->middle + c->right + c->fourth + c->fifth;
+}
+
+static void ReleaseChunks(SessionIndex* si)
+{
+    const size_t needed = (si->count + SESSION_CHUNK - 1) / SESSION_CHUNK;
+
+    while (si->chunkCount > needed) {
+        PoolFree(si->pool, si->chunks[--si->chunkCount], sizeof(Session) * SESSION_CHUNK);
+    }
+}
+
+static BOOL BreakBetween(const Session* older, const Session* newer)
+{
+    return newer->cumBreaks != older->cumBreaks;
+}
+
+// Merges neighbours among the older sessions, first only those without a
+// break between them, then pairwise regardless. The newest quarter is
+// left alone.
+static void Compact(SessionIndex* si, size_t goal)
+{
+    const size_t limit = si->count - si->count / 4;
+
+    for (int pass = 0; pass < 2 && si->count > goal; pass++) {
+        size_t out = 0;
+
+        for (size_t i = 0; i < si->count; i++) {
+            Session* s = SessionAt(si, i);
+
+            if (i < limit && out > 0) {
+                Session* previous = SessionAt(si, out - 1);
+                const BOOL merge = pass == 0 ? !BreakBetween(previous, s) : (i % 2) == 1;
+
+                if (merge) {
+                    const uint32 start = previous->start;
+
+                    *previous = *s;
+                    previous->start = start;
+                    si->merges++;
+                    continue;
+                }
+            }
+
+            *SessionAt(si, out++) = *s;
+        }
+
+        si->count = out;
+    }
+
+    ReleaseChunks(si);
+}
+
+// Pool pressure: merges older sessions until a chunk can be given back
+static size_t Evict(size_t wanted, void* userData)
+{
+    SessionIndex* si = (SessionIndex *)userData;
+    const size_t chunks = si->chunkCount;
+
+    (void)wanted;
+
+    if (chunks > 1) {
+        Compact(si, (chunks - 1) * SESSION_CHUNK - 1);
+    }
+
+    return (chunks - si->chunkCount) * sizeof(Session) * SESSION_CHUNK;
+}
+
+void SessionIndexInit(SessionIndex* si, Pool* pool, const int64* timeOffset, const Counter* counter)
+{
+    memset(si, 0, sizeof(*si));
+
+    si->pool = pool;
+    si->timeOffset = timeOffset;
+    si->lastKeys = counter->keys;
+    si->lastClicks = Clicks(counter);
+    si->lastPixels = counter->pixels;
+
+    PoolAddEvictor(pool, Evict, si);
+}
+
+void SessionIndexQuit(SessionIndex* si)
+{
+    si->count = 0;
+    ReleaseChunks(si);
+}
+
+// Makes room for one more session, merging old ones if there's no memory
+static BOOL Reserve(SessionIndex* si)
+{
+    if (si->count == SESSION_CAPACITY) {
+        Compact(si, SESSION_CAPACITY - 1);
+    }
+
+    if (si->count < si->chunkCount * SESSION_CHUNK) {
+        return TRUE;
+    }
+
+    Session* chunk = PoolAlloc(si->pool, sizeof(Session) * SESSION_CHUNK);
+
+    if (chunk) {
+        si->chunks[si->chunkCount++] = chunk;
+    } else if (si->count) {
+        Compact(si, si->count - 1);
+    }
+
+    return si->count < si->chunkCount * SESSION_CHUNK;
+}
+
+static BOOL StartSession(SessionIndex* si, uint32 start)
+{
+    if (!Reserve(si)) {
+        return FALSE;
+    }
+
+    const Session* previous = si->count ? SessionAt(si, si->count - 1) : &none;
+    Session* s = SessionAt(si, si->count);
+
+    *s = *previous;
+    s->start = start;
+    s->end = start;
+
+    if (si->count && start - previous->end >= BREAK_LENGTH) {
+        s->cumBreaks++;
+    }
+
+    si->count++;
+    si->open = TRUE;
+
+    return TRUE;
+}
+
+static void AddCounters(SessionIndex* si, Session* s, const Counter* counter)
+{
+    const size_t clicks = Clicks(counter);
+
+    s->cumKeys += counter->keys - si->lastKeys;
+    s->cumClicks += clicks - si->lastClicks;
+    s->cumPixels += counter->pixels - si->lastPixels;
+
+    si->lastKeys = counter->keys;
+    si->lastClicks = clicks;
+    si->lastPixels = counter->pixels;
+}
+
+void SessionIndexOnTick(const StatsTick* tick, void* userData)
+{
+    SessionIndex* si = (SessionIndex *)userData;
+
+    if (!tick->active) {
+        si->open = FALSE;
+        return;
+    }
+
+    uint32 from = (uint32)(tick->from + *si->timeOffset);
+
+    // Local time may have been set back, sessions must stay in order
+    if (si->count && from < SessionAt(si, si->count - 1)->end) {
+        from = SessionAt(si, si->count - 1)->end;
+    }
+
+    // Without memory for a new session the last one goes on
+    if (!si->open && !StartSession(si, from) && !si->count) {
+        return;
+    }
+
+    Session* s = SessionAt(si, si->count - 1);
+
+    s->end = from + tick->active;
+    s->cumActive += tick->active;
+
+    AddCounters(si, s, tick->counter);
+
+    if (tick->from + tick->active < tick->now) {
+        si->open = FALSE;
+    }
+}
+
+static size_t FirstEndingAfter(const SessionIndex* si, uint32 time)
+{
+    size_t low = 0;
+    size_t high = si->count;
+
+    while (low < high) {
+        const size_t mid = (low + high) / 2;
+
+        if (SessionAt(si, mid)->end > time) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    return low;
+}
+
+static size_t CountStartingBefore(const SessionIndex* si, uint32 time)
+{
+    size_t low = 0;
+    size_t high = si->count;
+
+    while (low < high) {
+        const size_t mid = (low + high) / 2;
+
+        if (SessionAt(si, mid)->start < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static uint64 Part(uint64 value, uint32 part, uint32 length)
+{
+    return length ? value * part / length : 0;
+}
+
+// Sessions cut by the range are counted in proportion to the overlap.
+// Breaks are counted when they end inside the range.
+void SessionIndexQuery(const SessionIndex* si, uint32 from, uint32 to, SessionTotals* totals)
+{
+    memset(totals, 0, sizeof(*totals));
+
+    const size_t first = FirstEndingAfter(si, from);
+    const size_t end = CountStartingBefore(si, to);
+
+    if (first >= end) {
+        return;
+    }
+
+    const size_t last = end - 1;
+    const Session* base = first ? SessionAt(si, first - 1) : &none;
+    const Session* a = SessionAt(si, first);
+    const Session* b = SessionAt(si, last);
+
+    uint64 active = b->cumActive - base->cumActive;
+    uint64 keys = b->cumKeys - base->cumKeys;
+    uint64 clicks = b->cumClicks - base->cumClicks;
+    uint64 pixels = b->cumPixels - base->cumPixels;
+
+    if (a->start < from) {
+        const uint32 cut = from - a->start;
+        const uint32 length = a->end - a->start;
+
+        active -= Part(a->cumActive - base->cumActive, cut, length);
+        keys -= Part(a->cumKeys - base->cumKeys, cut, length);
+        clicks -= Part(a->cumClicks - base->cumClicks, cut, length);
+        pixels -= Part(a->cumPixels - base->cumPixels, cut, length);
+    }
+
+    if (b->end > to) {
+        const Session* beforeB = last ? SessionAt(si, last - 1) : &none;
+        const uint32 cut = b->end - to;
+        const uint32 length = b->end - b->start;
+
+        active -= Part(b->cumActive - beforeB->cumActive, cut, length);
+        keys -= Part(b->cumKeys - beforeB->cumKeys, cut, length);
+        clicks -= Part(b->cumClicks - beforeB->cumClicks, cut, length);
+        pixels -= Part(b->cumPixels - beforeB->cumPixels, cut, length);
+    }
+
+    totals->sessions = end - first;
+    totals->active = active;
+    totals->keys = keys;
+    totals->clicks = clicks;
+    totals->pixels = pixels;
+    totals->breaks = b->cumBreaks - (a->start >= from ? base->cumBreaks : a->cumBreaks);
+}
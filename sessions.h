@@ -0,0 +1,89 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+
+#define SESSION_CAPACITY 8192
+#define SESSION_CHUNK 128 // Sessions per pool object, a power of two
+#define SESSION_CHUNKS (SESSION_CAPACITY / SESSION_CHUNK)
+
+// Sessions hold running totals up to and including themselves, so the
+// totals of any run of sessions is a difference of two entries, and
+// merging two neighbours only drops the older entry.
+typedef struct Session
+{
+    uint32 start;
+    uint32 end;
+    uint32 cumActive;
+    uint32 cumBreaks;
+    uint32 cumKeys;
+    uint32 cumClicks;
+    uint64 cumPixels;
+} Session;
+
+typedef struct SessionTotals
+{
+    size_t sessions;
+    size_t active;
+    size_t breaks;
+    size_t keys;
+    size_t clicks;
+    size_t pixels;
+} SessionTotals;
+
+// Sessions are stored in chunks from the pool as they're needed. If the
+// pool runs out, older sessions are merged to make room.
+typedef struct SessionIndex
+{
+    const int64* timeOffset; // Stats clock to local time, may change
+    size_t count;
+    size_t merges;
+    BOOL open;
+    size_t lastKeys;
+    size_t lastClicks;
+    size_t lastPixels;
+    Pool* pool;
+    size_t chunkCount;
+    Session* chunks[SESSION_CHUNKS];
+} SessionIndex;
+
+extern SessionIndex sessionIndex;
+
+static inline Session* SessionAt(const SessionIndex* si, size_t i)
+{
+    return &si->chunks[i / SESSION_CHUNK][i % SESSION_CHUNK];
+}
+
+void SessionIndexInit(SessionIndex* si, Pool* pool, const int64* timeOffset, const Counter* counter);
+void SessionIndexQuit(SessionIndex* si);
+void SessionIndexOnTick(const StatsTick* tick, void* userData);
+
+// Sessions cut by the range count in proportion, breaks count in the range
+// they end in
+void SessionIndexQuery(const SessionIndex* si, uint32 from, uint32 to, SessionTotals* totals);
@@ -0,0 +1,141 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+// Client API for reading Activity meter's live counters. The meter keeps
+// the snapshot in the memory of a public message port and rewrites it once
+// a second, or once a minute while it's iconified and there's no input.
+// Readers copy it directly, so polling costs the meter nothing.
+//
+// The header stands alone: it only needs the system headers.
+//
+//    SnapshotPort* port = SnapshotOpen();
+//    ActivitySnapshot copy;
+//
+//    if (port && SnapshotRead(&port->snapshot, &copy)) {
+//        ...
+//    }
+//
+//    SnapshotClose(port);
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __amigaos4__
+#include <exec/types.h>
+#include <proto/exec.h>
+#endif
+
+#define SNAPSHOT_PORT_NAME "ActivityMeter.snapshot"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_READ_ATTEMPTS 16
+
+#define SNAPSHOT_BARRIER() __sync_synchronize()
+
+// New fields are only added to the end. 'size' tells how much of the
+// structure the meter fills in.
+typedef struct ActivitySnapshot
+{
+    uint32_t sequence; // Odd while the meter is writing
+    uint32_t version;
+    uint32_t size;
+    uint32_t time; // Local time of the update, seconds since 1.1.1970
+    uint32_t activeTotal; // Seconds
+    uint32_t currentActivity;
+    uint32_t currentBreak;
+    uint32_t breaks;
+    uint32_t todayActive; // Updated as each minute closes
+    uint32_t todayKeys;
+    uint64_t left;
+    uint64_t middle;
+    uint64_t right;
+    uint64_t fourth;
+    uint64_t fifth;
+    uint64_t keys;
+    uint64_t pixels;
+} ActivitySnapshot;
+
+// Returns 0 if the meter kept writing during every attempt or the version
+// is unknown. Never waits for the meter.
+static inline int SnapshotRead(const ActivitySnapshot* shared, ActivitySnapshot* copy)
+{
+    const volatile uint32_t* sequence = &shared->sequence;
+
+    for (int attempt = 0; attempt < SNAPSHOT_READ_ATTEMPTS; attempt++) {
+        const uint32_t before = *sequence;
+
+        if (before & 1) {
+            continue;
+        }
+
+        SNAPSHOT_BARRIER();
+        memcpy(copy, shared, sizeof(*copy));
+        SNAPSHOT_BARRIER();
+
+        if (*sequence == before) {
+            return copy->version == SNAPSHOT_VERSION;
+        }
+    }
+
+    return 0;
+}
+
+#ifdef __amigaos4__
+
+typedef struct SnapshotPort
+{
+    struct MsgPort port;
+    uint32 clients; // Changed under Forbid()
+    ActivitySnapshot snapshot;
+} SnapshotPort;
+
+// The meter doesn't free the port while clients hold it open
+static inline SnapshotPort* SnapshotOpen(void)
+{
+    IExec->Forbid();
+
+    SnapshotPort* port = (SnapshotPort *)IExec->FindPort(SNAPSHOT_PORT_NAME);
+
+    if (port) {
+        port->clients++;
+    }
+
+    IExec->Permit();
+
+    return port;
+}
+
+static inline void SnapshotClose(SnapshotPort* port)
+{
+    if (port) {
+        IExec->Forbid();
+        port->clients--;
+        IExec->Permit();
+    }
+}
+
+#endif
@@ -0,0 +1,400 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "common.h"
+
+typedef struct Statistics
+{
+    size_t startTime;
+    size_t startTimeCurrent;
+    size_t activeSecondsTotal;
+    size_t activeSeconds;
+    size_t breakSeconds;
+    size_t currentBreakDuration;
+    size_t breaks;
+    size_t lastTick;
+    size_t lastActive;
+    size_t lastActivity;
+    BOOL breakRegistered;
+    BOOL sleeping;
+} Statistics;
+
+static Counter* counter;
+static Counter lastCounter; // As of the last step
+static Clock* timeSource;
+static Statistics stats;
+
+static const size_t PASSIVE_THRESHOLD = 4;
+
+#define MAX_OBSERVERS 8
+
+static struct {
+    StatsObserver observer;
+    void* userData;
+} observers[MAX_OBSERVERS];
+
+static size_t observerCount;
+
+static size_t SecsToMins(size_t seconds)
+{
+    return seconds / 60;
+}
+
+static size_t ModMinute(size_t seconds)
+{
+    return seconds % 60;
+}
+
+void InitStats(Counter* c, Clock* source)
+{
+    counter = c;
+    timeSource = source;
+
+    if (stats.startTime == 0) {
+        stats.startTime = ClockSeconds(timeSource);
+        stats.startTimeCurrent = stats.startTime;
+        stats.lastTick = stats.startTime;
+        stats.lastActive = stats.startTime;
+        stats.lastActivity = counter->activity;
+        lastCounter = *counter;
+    }
+}
+
+static void CalculateTotalActivity()
+{
+    stats.activeSecondsTotal = stats.lastActive - stats.startTime;
+}
+
+// Activity is sampled per call, so the elapsed time since the previous call
+// can be anything from a fraction of a second to days of simulated time. The
+// part up to PASSIVE_THRESHOLD seconds after the last activity is active,
+// the rest is break. 'values' are the counters the observers see.
+static void Accumulate(size_t now, const Counter* values, BOOL sampleActivity)
+{
+    if (now <= stats.lastTick) {
+        return;
+    }
+
+    if (sampleActivity && counter->activity != stats.lastActivity) {
+        stats.lastActivity = counter->activity;
+        stats.lastActive = now;
+    }
+
+    const size_t activeUntil = stats.lastActive + PASSIVE_THRESHOLD;
+    const size_t elapsed = now - stats.lastTick;
+    size_t active = 0;
+
+    if (activeUntil > stats.lastTick) {
+        active = (now < activeUntil ? now : activeUntil) - stats.lastTick;
+    }
+
+    const size_t passive = elapsed - active;
+
+    if (passive) {
+        stats.breakSeconds = (active ? 0 : stats.breakSeconds) + passive;
+        stats.activeSeconds = 0;
+    } else {
+        stats.breakSeconds = 0;
+        stats.activeSeconds += active;
+    }
+
+    const StatsTick tick = {
+        stats.lastTick,
+        now,
+        active,
+        stats.activeSeconds,
+        stats.breakSeconds,
+        values
+    };
+
+    for (size_t i = 0; i < observerCount; i++) {
+        observers[i].observer(&tick, observers[i].userData);
+    }
+
+    stats.lastTick = now;
+    lastCounter = *values;
+}
+
+static void RegisterBreaks()
+{
+    stats.currentBreakDuration = stats.breakSeconds;
+
+    if (!stats.breakRegistered && stats.currentBreakDuration >= BREAK_LENGTH) {
+        stats.breaks++;
+        stats.breakRegistered = TRUE;
+    } else if (stats.breakRegistered && stats.currentBreakDuration < BREAK_LENGTH) {
+        stats.breakRegistered = FALSE;
+    }
+}
+
+BOOL StatsAddObserver(StatsObserver observer, void* userData)
+{
+    if (observerCount >= MAX_OBSERVERS) {
+        return FALSE;
+    }
+
+    observers[observerCount].observer = observer;
+    observers[observerCount].userData = userData;
+    observerCount++;
+
+    return TRUE;
+}
+
+// Also valid from observers, before CalculateStats() has finished
+void StatsGetSummary(StatsSummary* summary)
+{
+    summary->activeSecondsTotal = stats.lastActive - stats.startTime;
+    summary->activeSeconds = stats.activeSeconds;
+    summary->breakSeconds = stats.breakSeconds;
+    summary->breaks = stats.breaks;
+    summary->lastActive = stats.lastActive;
+
+    if (!stats.breakRegistered && stats.breakSeconds >= BREAK_LENGTH) {
+        summary->breaks++;
+    }
+}
+
+BOOL StatsSleep(void* task, uint32 signal)
+{
+    if (!stats.breakSeconds) {
+        return FALSE;
+    }
+
+    // Armed before looking for input, so none can slip in between. The
+    // handler may see the signal as soon as it's stored, so the task goes
+    // first.
+    counter->wakeTask = task;
+    __sync_synchronize();
+    counter->wakeSignal = signal;
+    __sync_synchronize();
+
+    // Only after the last activity has been accounted for
+    if (counter->activity != stats.lastActivity) {
+        counter->wakeSignal = 0;
+        return FALSE;
+    }
+
+    stats.sleeping = TRUE;
+
+    return TRUE;
+}
+
+BOOL StatsSleeping()
+{
+    return stats.sleeping;
+}
+
+void CalculateStats()
+{
+    const size_t now = ClockSeconds(timeSource);
+
+    if (stats.sleeping) {
+        stats.sleeping = FALSE;
+        counter->wakeSignal = 0;
+
+        // Any input since the last step woke us up just now, so the time
+        // so far was idle. The input is counted by the next tick, like it
+        // would have been without sleeping.
+        if (counter->activity != stats.lastActivity) {
+            Accumulate(now, &lastCounter, FALSE);
+            CalculateTotalActivity();
+            RegisterBreaks();
+            return;
+        }
+    }
+
+    // A step that blocked for long, like a modal requester, only tells that
+    // there was input somewhere in it. Count it at the end of the step, so
+    // the time before is a break instead of activity.
+    if (counter->activity != stats.lastActivity && now > stats.lastTick + PASSIVE_THRESHOLD + 1) {
+        Accumulate(now - 1, &lastCounter, FALSE);
+        RegisterBreaks();
+    }
+
+    Accumulate(now, counter, TRUE);
+    CalculateTotalActivity();
+    RegisterBreaks();
+}
+
+static const char* DurationString(FormatCache* cache, const char* const label, size_t length, size_t seconds)
+{
+    const uint64 keys[] = { seconds };
+
+    if (FormatCacheStale(cache, keys, 1)) {
+        FormatBuilder b;
+
+        FormatBegin(&b, cache->text, sizeof(cache->text));
+        FormatText(&b, label, length);
+        FormatNumber(&b, SecsToMins(seconds));
+        FormatText(&b, FORMAT_LABEL(" min "));
+        FormatNumber(&b, ModMinute(seconds));
+        FormatText(&b, FORMAT_LABEL(" secs"));
+        FormatEnd(&b);
+    }
+
+    return cache->text;
+}
+
+static const char* CountString(FormatCache* cache, const char* const label, size_t length, size_t value)
+{
+    const uint64 keys[] = { value };
+
+    if (FormatCacheStale(cache, keys, 1)) {
+        FormatBuilder b;
+
+        FormatBegin(&b, cache->text, sizeof(cache->text));
+        FormatText(&b, label, length);
+        FormatNumber(&b, value);
+        FormatEnd(&b);
+    }
+
+    return cache->text;
+}
+
+static const char* ButtonsString(FormatCache* cache)
+{
+    const uint64 keys[] = { counter->left, counter->middle, counter->right, counter->fourth, counter->fifth };
+
+    if (FormatCacheStale(cache, keys, 5)) {
+        FormatBuilder b;
+
+        FormatBegin(&b, cache->text, sizeof(cache->text));
+        FormatText(&b, FORMAT_LABEL("LMB: "));
+        FormatNumber(&b, keys[0]);
+        FormatText(&b, FORMAT_LABEL(", MMB: "));
+        FormatNumber(&b, keys[1]);
+        FormatText(&b, FORMAT_LABEL(", RMB: "));
+        FormatNumber(&b, keys[2]);
+        FormatText(&b, FORMAT_LABEL(", 4th: "));
+        FormatNumber(&b, keys[3]);
+        FormatText(&b, FORMAT_LABEL(", 5th: "));
+        FormatNumber(&b, keys[4]);
+        FormatEnd(&b);
+    }
+
+    return cache->text;
+}
+
+// Fits under an icon: the running activity, or the break and how far it
+// is from counting as one
+static const char* IconTitle(FormatCache* cache)
+{
+    const BOOL onBreak = stats.breakSeconds > 0;
+    const uint64 keys[] = { onBreak, SecsToMins(onBreak ? stats.breakSeconds : stats.activeSeconds) };
+
+    if (FormatCacheStale(cache, keys, 2)) {
+        FormatBuilder b;
+
+        FormatBegin(&b, cache->text, sizeof(cache->text));
+
+        if (onBreak) {
+            FormatText(&b, FORMAT_LABEL("Break "));
+            FormatNumber(&b, keys[1]);
+
+            if (stats.breakSeconds < BREAK_LENGTH) {
+                FormatText(&b, FORMAT_LABEL("/"));
+                FormatNumber(&b, SecsToMins(BREAK_LENGTH));
+            }
+        } else {
+            FormatText(&b, FORMAT_LABEL("Active "));
+            FormatNumber(&b, keys[1]);
+        }
+
+        FormatText(&b, FORMAT_LABEL(" min"));
+        FormatEnd(&b);
+    }
+
+    return cache->text;
+}
+
+const char* StatsFormat(EStatsString id, FormatCache* cache)
+{
+    switch (id) {
+        case EStatsString_AllActivity:
+            return DurationString(cache, FORMAT_LABEL("All activity time: "), stats.activeSecondsTotal);
+        case EStatsString_CurrentActivity:
+            return DurationString(cache, FORMAT_LABEL("Current activity time: "), stats.activeSeconds);
+        case EStatsString_Break:
+            return DurationString(cache, FORMAT_LABEL("Break time: "), stats.breakSeconds);
+        case EStatsString_TotalBreaks:
+            return CountString(cache, FORMAT_LABEL("Total breaks: "), stats.breaks);
+        case EStatsString_MouseCounter:
+            return ButtonsString(cache);
+        case EStatsString_KeyCounter:
+            return CountString(cache, FORMAT_LABEL("Keys pressed: "), counter->keys);
+        case EStatsString_Pixels:
+            return CountString(cache, FORMAT_LABEL("Pixels travelled: "), counter->pixels);
+        case EStatsString_IconTitle:
+            return IconTitle(cache);
+        case EStatsString_Count:
+            break;
+    }
+
+    return "";
+}
+
+// The GUI's caches
+static FormatCache caches[EStatsString_Count];
+
+char* AllActivityString()
+{
+    return (char *)StatsFormat(EStatsString_AllActivity, &caches[EStatsString_AllActivity]);
+}
+
+char* CurrentActivityString()
+{
+    return (char *)StatsFormat(EStatsString_CurrentActivity, &caches[EStatsString_CurrentActivity]);
+}
+
+char* BreakString()
+{
+    return (char *)StatsFormat(EStatsString_Break, &caches[EStatsString_Break]);
+}
+
+char* TotalBreaksString()
+{
+    return (char *)StatsFormat(EStatsString_TotalBreaks, &caches[EStatsString_TotalBreaks]);
+}
+
+char* MouseCounterString()
+{
+    return (char *)StatsFormat(EStatsString_MouseCounter, &caches[EStatsString_MouseCounter]);
+}
+
+char* KeyCounterString()
+{
+    return (char *)StatsFormat(EStatsString_KeyCounter, &caches[EStatsString_KeyCounter]);
+}
+
+char* PixelsString()
+{
+    return (char *)StatsFormat(EStatsString_Pixels, &caches[EStatsString_Pixels]);
+}
+
+char* IconTitleString()
+{
+    return (char *)StatsFormat(EStatsString_IconTitle, &caches[EStatsString_IconTitle]);
+}
@@ -26,6 +26,7 @@ SOFTWARE.
 
 #include "timer.h"
 #include "logger.h"
+#include "clock.h"
 
 #include <proto/exec.h>
 #include <proto/timer.h>
@@ -37,6 +38,7 @@ static ULONG frequency = 0;
 static int users = 0;
 
 TimerContext timer;
+TimerQueue timerQueue;
 
 static void ReadFrequency(void)
 {
@@ -51,6 +53,8 @@ BOOL TimerInit(TimerContext * tc)
     tc->port = NULL;
     tc->request = NULL;
     tc->device = -1;
+    tc->pending = FALSE;
+    tc->wakeup = 0;
 
     tc->port = IExec->AllocSysObjectTags(ASOT_PORT,
         ASOPORT_Name, "timer_port",
@@ -71,7 +75,7 @@ BOOL TimerInit(TimerContext * tc)
         goto out;
     }
 
-    tc->device = IExec->OpenDevice(TIMERNAME, UNIT_WAITUNTIL,
+    tc->device = IExec->OpenDevice(TIMERNAME, UNIT_MICROHZ,
         (struct IORequest *) tc->request, 0);
 
     if (tc->device) {
@@ -137,33 +141,22 @@ uint32 TimerSignal(TimerContext * tc)
     return 1L << tc->port->mp_SigBit;
 }
 
+// Relative delay on UNIT_MICROHZ so that setting the system clock doesn't
+// affect pending requests
 void TimerStart(TimerContext * tc, ULONG seconds, ULONG micros)
 {
-    struct TimeVal tv;
-    struct TimeVal increment;
-
     if (!tc->request) {
         Log("%s: timer request NULL", __func__);
         return;
     }
 
-    if (!ITimer) {
-        Log("%s: ITimer NULL", __func__);
-        return;
-    }
-
-    ITimer->GetSysTime(&tv);
-
-    increment.Seconds = seconds;
-    increment.Microseconds = micros;
-
-    ITimer->AddTime(&tv, &increment);
-
     tc->request->Request.io_Command = TR_ADDREQUEST;
-    tc->request->Time.Seconds = tv.Seconds;
-    tc->request->Time.Microseconds = tv.Microseconds;
+    tc->request->Time.Seconds = seconds;
+    tc->request->Time.Microseconds = micros;
 
     IExec->SendIO((struct IORequest *) tc->request);
+
+    tc->pending = TRUE;
 }
 
 void TimerHandleEvents(TimerContext * tc)
@@ -178,6 +171,8 @@ void TimerHandleEvents(TimerContext * tc)
     while ((msg = IExec->GetMsg(tc->port))) {
         const int8 error = ((struct IORequest *)msg)->io_Error;
 
+        tc->pending = FALSE;
+
         if (error) {
             printf("Timer message received with code %d\n", error);
         }
@@ -191,11 +186,49 @@ void TimerStop(TimerContext * tc)
         return;
     }
 
+    if (!tc->pending) {
+        return;
+    }
+
     if (!IExec->CheckIO((struct IORequest *) tc->request)) {
         Log("%s: aborting timer IO request %p", __func__, tc->request);
         IExec->AbortIO((struct IORequest *) tc->request);
-        IExec->WaitIO((struct IORequest *) tc->request);
     }
+
+    // Removes the reply from the port if it's already there
+    IExec->WaitIO((struct IORequest *) tc->request);
+    IExec->SetSignal(0, TimerSignal(tc));
+
+    tc->pending = FALSE;
+}
+
+// Keeps exactly one TR_ADDREQUEST outstanding, for the earliest wakeup the
+// queue needs. A pending request that fires no later than that is kept.
+void TimerArmQueue(TimerContext * tc, TimerQueue * tq)
+{
+    uint64 wakeup;
+
+    if (!TimerQueueNextWakeup(tq, &wakeup)) {
+        if (tc->pending) {
+            TimerStop(tc);
+        }
+        return;
+    }
+
+    if (tc->pending) {
+        if (tc->wakeup <= wakeup) {
+            return;
+        }
+
+        TimerStop(tc);
+    }
+
+    const uint64 now = ClockNow(tq->clock);
+    const uint64 delay = wakeup > now ? wakeup - now : 0;
+
+    tc->wakeup = wakeup;
+
+    TimerStart(tc, delay / 1000000, delay % 1000000);
 }
 
 ESignalType TimerWaitForSignal(uint32 timerSig, const char* const name)
@@ -220,3 +253,39 @@ struct TimeVal TimerGetSysTime()
     ITimer->GetSysTime(&tv);
     return tv;
 }
+
+static uint64 EClockNow(Clock* clock)
+{
+    (void)clock;
+
+    struct EClockVal clockVal;
+    ITimer->ReadEClock(&clockVal);
+
+    const uint64 ticks = ((uint64)clockVal.ev_hi << 32) | clockVal.ev_lo;
+
+    return (ticks / frequency) * 1000000 + (ticks % frequency) * 1000000 / frequency;
+}
+
+static uint64 SysTimeNow(Clock* clock)
+{
+    (void)clock;
+
+    // System time counts from 1.1.1978
+    static const uint64 amigaEpochOffset = 252460800;
+
+    const struct TimeVal tv = TimerGetSysTime();
+
+    return (tv.Seconds + amigaEpochOffset) * 1000000 + tv.Microseconds;
+}
+
+Clock* MonotonicClock()
+{
+    static Clock clock = { EClockNow, 0 };
+    return &clock;
+}
+
+Clock* WallClock()
+{
+    static Clock clock = { SysTimeNow, 0 };
+    return &clock;
+}
@@ -26,6 +26,8 @@ SOFTWARE.
 
 #pragma once
 
+#include "timerqueue.h"
+
 #include <exec/types.h>
 
 typedef struct TimerContext
@@ -33,6 +35,8 @@ typedef struct TimerContext
     struct MsgPort* port;
     struct TimeRequest* request;
     BYTE device;
+    BOOL pending;
+    uint64 wakeup;
 } TimerContext;
 
 typedef enum ESignalType {
@@ -41,6 +45,7 @@ typedef enum ESignalType {
 } ESignalType;
 
 extern TimerContext timer;
+extern TimerQueue timerQueue;
 
 BOOL TimerInit(TimerContext * tc);
 void TimerQuit(TimerContext * tc);
@@ -50,6 +55,7 @@ uint32 TimerSignal(TimerContext * tc);
 void TimerStart(TimerContext * tc, ULONG seconds, ULONG micros);
 void TimerStop(TimerContext * tc);
 void TimerHandleEvents(TimerContext * tc);
+void TimerArmQueue(TimerContext * tc, TimerQueue * tq);
 
 ESignalType TimerWaitForSignal(uint32 timerSig, const char* const name);
 
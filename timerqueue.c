@@ -0,0 +1,206 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "timerqueue.h"
+
+#include <string.h>
+
+// Binary min-heap of timer ids ordered by the latest acceptable firing
+// time (deadline + slack). The top of the heap decides the wakeup, and at
+// that point every timer whose deadline has passed is fired as well.
+
+static uint64 Latest(const TimerQueue* tq, int id)
+{
+    const LogicalTimer* t = &tq->timers[id];
+    return t->deadline + t->slack;
+}
+
+static void Swap(TimerQueue* tq, int a, int b)
+{
+    const int id = tq->heap[a];
+
+    tq->heap[a] = tq->heap[b];
+    tq->heap[b] = id;
+
+    tq->timers[tq->heap[a]].heapIndex = a;
+    tq->timers[tq->heap[b]].heapIndex = b;
+}
+
+static void SiftUp(TimerQueue* tq, int index)
+{
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+
+        if (Latest(tq, tq->heap[parent]) <= Latest(tq, tq->heap[index])) {
+            break;
+        }
+
+        Swap(tq, parent, index);
+        index = parent;
+    }
+}
+
+static void SiftDown(TimerQueue* tq, int index)
+{
+    while (TRUE) {
+        const int left = 2 * index + 1;
+        const int right = left + 1;
+        int smallest = index;
+
+        if (left < tq->count && Latest(tq, tq->heap[left]) < Latest(tq, tq->heap[smallest])) {
+            smallest = left;
+        }
+
+        if (right < tq->count && Latest(tq, tq->heap[right]) < Latest(tq, tq->heap[smallest])) {
+            smallest = right;
+        }
+
+        if (smallest == index) {
+            break;
+        }
+
+        Swap(tq, smallest, index);
+        index = smallest;
+    }
+}
+
+static void Insert(TimerQueue* tq, int id)
+{
+    const int index = tq->count++;
+
+    tq->heap[index] = id;
+    tq->timers[id].heapIndex = index;
+
+    SiftUp(tq, index);
+}
+
+static void Remove(TimerQueue* tq, int id)
+{
+    const int index = tq->timers[id].heapIndex;
+
+    if (index < 0) {
+        return;
+    }
+
+    tq->timers[id].heapIndex = -1;
+
+    const int last = --tq->count;
+
+    if (index != last) {
+        tq->heap[index] = tq->heap[last];
+        tq->timers[tq->heap[index]].heapIndex = index;
+
+        SiftDown(tq, index);
+        SiftUp(tq, index);
+    }
+}
+
+void TimerQueueInit(TimerQueue* tq, Clock* clock)
+{
+    memset(tq, 0, sizeof(*tq));
+
+    tq->clock = clock;
+
+    for (int i = 0; i < ETimer_Count; i++) {
+        tq->timers[i].heapIndex = -1;
+    }
+}
+
+void TimerQueueSchedule(TimerQueue* tq, ETimer id, uint64 delay, uint64 period, uint64 slack,
+    TimerCallback callback, void* userData)
+{
+    Remove(tq, id);
+
+    LogicalTimer* t = &tq->timers[id];
+
+    t->deadline = ClockNow(tq->clock) + delay;
+    t->period = period;
+    t->slack = slack;
+    t->callback = callback;
+    t->userData = userData;
+
+    Insert(tq, id);
+}
+
+void TimerQueueCancel(TimerQueue* tq, ETimer id)
+{
+    Remove(tq, id);
+}
+
+BOOL TimerQueueIsScheduled(const TimerQueue* tq, ETimer id)
+{
+    return tq->timers[id].heapIndex >= 0;
+}
+
+BOOL TimerQueueNextWakeup(const TimerQueue* tq, uint64* wakeup)
+{
+    if (tq->count == 0) {
+        return FALSE;
+    }
+
+    *wakeup = Latest(tq, tq->heap[0]);
+
+    return TRUE;
+}
+
+size_t TimerQueueRun(TimerQueue* tq, uint64 now)
+{
+    int due[ETimer_Count];
+    size_t count = 0;
+
+    tq->wakeups++;
+
+    // Collect first so callbacks are free to reschedule any timer
+    for (int i = 0; i < ETimer_Count; i++) {
+        LogicalTimer* t = &tq->timers[i];
+
+        if (t->heapIndex >= 0 && t->deadline <= now) {
+            Remove(tq, i);
+
+            if (t->period) {
+                do {
+                    t->deadline += t->period;
+                } while (t->deadline <= now);
+
+                Insert(tq, i);
+            }
+
+            due[count++] = i;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        LogicalTimer* t = &tq->timers[due[i]];
+
+        if (t->callback) {
+            t->callback(t->userData);
+        }
+    }
+
+    tq->fired += count;
+
+    return count;
+}
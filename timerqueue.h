@@ -0,0 +1,75 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "clock.h"
+
+// Logical timers multiplexed on one timer.device request. Each timer has a
+// slack: it may fire up to that much late so that timers with nearby
+// deadlines are served by the same wakeup.
+
+typedef enum ETimer {
+    ETimer_Refresh,
+    ETimer_JournalFlush,
+    ETimer_Reminder,
+    ETimer_Midnight,
+    ETimer_Compaction,
+    ETimer_Metrics,
+    ETimer_Count // KEEP LAST
+} ETimer;
+
+typedef void (*TimerCallback)(void* userData);
+
+typedef struct LogicalTimer
+{
+    uint64 deadline;
+    uint64 period;
+    uint64 slack;
+    TimerCallback callback;
+    void* userData;
+    int heapIndex;
+} LogicalTimer;
+
+typedef struct TimerQueue
+{
+    Clock* clock;
+    LogicalTimer timers[ETimer_Count];
+    int heap[ETimer_Count];
+    int count;
+    size_t wakeups;
+    size_t fired;
+} TimerQueue;
+
+void TimerQueueInit(TimerQueue* tq, Clock* clock);
+
+void TimerQueueSchedule(TimerQueue* tq, ETimer id, uint64 delay, uint64 period, uint64 slack,
+    TimerCallback callback, void* userData);
+void TimerQueueCancel(TimerQueue* tq, ETimer id);
+BOOL TimerQueueIsScheduled(const TimerQueue* tq, ETimer id);
+
+BOOL TimerQueueNextWakeup(const TimerQueue* tq, uint64* wakeup);
+size_t TimerQueueRun(TimerQueue* tq, uint64 now);
@@ -0,0 +1,96 @@
+/*
+
+MIT License
+
+Copyright (c) 2020 Juha Niemimaki
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "platform.h"
+
+#include <stddef.h>
+
+// Unsigned LEB128 and zigzag helpers shared by the on-disk formats
+
+#define VARINT_MAX_BYTES 10
+
+static inline size_t VarintPut(uint8* dst, uint64 value)
+{
+    size_t len = 0;
+
+    while (value >= 0x80) {
+        dst[len++] = (uint8)(value | 0x80);
+        value >>= 7;
+    }
+
+    dst[len++] = (uint8)value;
+
+    return len;
+}
+
+static inline size_t VarintGet(const uint8* src, const uint8* end, uint64* value)
+{
+    uint64 result = 0;
+    int shift = 0;
+    size_t len = 0;
+
+    while (src + len < end && shift < 64) {
+        const uint8 b = src[len++];
+
+        result |= (uint64)(b & 0x7F) << shift;
+
+        if (!(b & 0x80)) {
+            *value = result;
+            return len;
+        }
+
+        shift += 7;
+    }
+
+    return 0;
+}
+
+static inline uint64 ZigZagEncode(int64 value)
+{
+    return ((uint64)value << 1) ^ (uint64)(value >> 63);
+}
+
+static inline int64 ZigZagDecode(uint64 value)
+{
+    return (int64)(value >> 1) ^ -(int64)(value & 1);
+}
+
+// Fixed-width fields are stored big-endian so files move between hosts
+
+static inline void PutBE32(uint8* dst, uint32 value)
+{
+    dst[0] = (uint8)(value >> 24);
+    dst[1] = (uint8)(value >> 16);
+    dst[2] = (uint8)(value >> 8);
+    dst[3] = (uint8)value;
+}
+
+static inline uint32 GetBE32(const uint8* src)
+{
+    return ((uint32)src[0] << 24) | ((uint32)src[1] << 16) | ((uint32)src[2] << 8) | src[3];
+}